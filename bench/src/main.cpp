@@ -0,0 +1,348 @@
+#include <malloc.h>
+#include <memory/allocator.h>
+#include <memory/memory_control_block.h>
+#include <memory/memory_control_block_list.h>
+#include <memory/size_class.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Hse allocates memory with hse::malloc and friends
+struct Hse {
+    static void *malloc(std::size_t size) noexcept { return hse::malloc(size); }
+    static void *realloc(void *ptr, std::size_t size) noexcept { return hse::realloc(ptr, size); }
+    static void *aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
+        return hse::aligned_alloc(alignment, size);
+    }
+    static void free(void *ptr) noexcept { hse::free(ptr); }
+    static void *operator_new(std::size_t size) { return hse::operator_new(size); }
+    static void operator_delete(void *ptr, std::size_t size) noexcept { hse::operator_delete(ptr, size); }
+    static std::size_t malloc_batch(std::size_t size, std::size_t count, void **ptrs) noexcept {
+        return hse::malloc_batch(size, count, ptrs);
+    }
+    static void free_batch(void **ptrs, std::size_t count) noexcept { hse::free_batch(ptrs, count); }
+};
+
+// System allocates memory with malloc of the C library
+struct System {
+    static void *malloc(std::size_t size) noexcept { return std::malloc(size); }
+    static void *realloc(void *ptr, std::size_t size) noexcept { return std::realloc(ptr, size); }
+    static void *aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
+        return std::aligned_alloc(alignment, size);
+    }
+    static void free(void *ptr) noexcept { std::free(ptr); }
+    static void *operator_new(std::size_t size) { return ::operator new(size); }
+    static void operator_delete(void *ptr, std::size_t size) noexcept { ::operator delete(ptr, size); }
+    static std::size_t malloc_batch(std::size_t size, std::size_t count, void **ptrs) noexcept {
+        std::generate_n(ptrs, count, [size] { return std::malloc(size); });
+        return count;
+    }
+    static void free_batch(void **ptrs, std::size_t count) noexcept { std::for_each_n(ptrs, count, std::free); }
+};
+
+// Latencies samples duration of every SAMPLE_EVERY-th operation
+// and reports percentiles of them as counters
+class Latencies {
+  public:
+    static constexpr std::size_t SAMPLE_EVERY = 64;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::int64_t> samples_;
+    std::size_t count_ = 0;
+
+  public:
+    // measure calls given function measuring its duration if it is sampled
+    template<typename F>
+    void measure(F f) {
+        if (this->count_++ % SAMPLE_EVERY != 0) {
+            f();
+            return;
+        }
+
+        auto start = Clock::now();
+        f();
+        this->samples_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    // report sets percentiles of sampled durations in nanoseconds
+    void report(benchmark::State &state) {
+        if (this->samples_.empty()) {
+            return;
+        }
+        std::sort(this->samples_.begin(), this->samples_.end());
+        auto percentile = [this](double p) {
+            return static_cast<double>(this->samples_[static_cast<std::size_t>(p * static_cast<double>(this->samples_.size() - 1))]);
+        };
+        state.counters["p50_ns"] = percentile(0.5);
+        state.counters["p99_ns"] = percentile(0.99);
+        state.counters["p999_ns"] = percentile(0.999);
+    }
+};
+
+// Random is xorshift generator of deterministic sizes
+class Random {
+    std::uint64_t state_;
+
+  public:
+    explicit Random(std::uint64_t seed) noexcept : state_(seed) {}
+
+    std::uint64_t operator()() noexcept {
+        this->state_ ^= this->state_ << 13U;
+        this->state_ ^= this->state_ >> 7U;
+        this->state_ ^= this->state_ << 17U;
+        return this->state_;
+    }
+};
+
+// BM_FixedSize allocates and frees memory of the same size
+template<typename A>
+void BM_FixedSize(benchmark::State &state) {
+    auto size = static_cast<std::size_t>(state.range(0));
+    Latencies latencies;
+    for (auto _ : state) {
+        latencies.measure([size] {
+            void *ptr = A::malloc(size);
+            benchmark::DoNotOptimize(ptr);
+            A::free(ptr);
+        });
+    }
+    state.SetItemsProcessed(state.iterations());
+    latencies.report(state);
+}
+
+// BM_NewDelete allocates and deletes memory of the same size
+// as operator new and sized operator delete do
+template<typename A>
+void BM_NewDelete(benchmark::State &state) {
+    auto size = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state) {
+        void *ptr = A::operator_new(size);
+        benchmark::DoNotOptimize(ptr);
+        A::operator_delete(ptr, size);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// residentSize returns the size of resident memory of the process
+std::size_t residentSize() {
+    std::size_t size = 0;
+    std::size_t resident = 0;
+    std::ifstream("/proc/self/statm") >> size >> resident;
+    return resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+// BM_Placement replaces blocks of random medium sizes in a window
+// of live ones with a separate Allocator using given placement policy
+// and reports fragmentation of its memory and growth of resident memory
+void BM_Placement(benchmark::State &state) {
+    using hse::memory::MemoryControlBlock;
+    using hse::memory::Placement;
+    constexpr std::size_t WINDOW = 4096;
+    constexpr std::size_t SHORT_LIVED = 256;
+    constexpr std::size_t PAGE = 4096;
+    constexpr std::array<const char *, 3> NAMES{"lifo", "address", "best"};
+
+    auto placement = static_cast<Placement>(state.range(0));
+    state.SetLabel(NAMES.at(static_cast<std::size_t>(placement)));
+    auto before = residentSize();
+    auto allocator = std::make_unique<hse::memory::Allocator>();
+    allocator->setPlacement(placement);
+
+    Random random{42};
+    std::array<std::pair<std::uintptr_t, std::size_t>, WINDOW> window{};
+    std::size_t live = 0;
+    for (auto _ : state) {
+        auto &[ptr, size] = window[random() % 8 == 0 ? random() % WINDOW : random() % SHORT_LIVED];
+        if (ptr != 0) {
+            allocator->free(ptr);
+            live -= size;
+        }
+
+        // sizes are log-uniform from slabs to 64 KiB
+        auto base = hse::memory::SMALL_SIZE_MAX << (random() % 6);
+        size = (base + random() % base + MemoryControlBlock::ALIGNMENT) & ~(MemoryControlBlock::ALIGNMENT - 1);
+        ptr = allocator->alloc(size, MemoryControlBlock::ALIGNMENT);
+        live += size;
+        for (std::size_t offset = 0; offset < size; offset += PAGE) {
+            reinterpret_cast<char *>(ptr)[offset] = 1;
+        }
+    }
+
+    auto freeBytes = static_cast<double>(allocator->freeStats().freeBytes);
+    state.counters["fragmentation"] = freeBytes / (freeBytes + static_cast<double>(live));
+    state.counters["rss_mb"] = static_cast<double>(residentSize() - before) / (1 << 20);
+    for (auto [ptr, size] : window) {
+        if (ptr != 0) {
+            allocator->free(ptr);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// BM_Burst allocates and frees a burst of blocks of given size
+// with malloc_batch and free_batch
+template<typename A>
+void BM_Burst(benchmark::State &state) {
+    constexpr std::size_t BURST = 256;
+    auto size = static_cast<std::size_t>(state.range(0));
+    std::array<void *, BURST> ptrs{};
+
+    Latencies latencies;
+    for (auto _ : state) {
+        latencies.measure([size, &ptrs] {
+            auto count = A::malloc_batch(size, ptrs.size(), ptrs.data());
+            benchmark::DoNotOptimize(ptrs.data());
+            A::free_batch(ptrs.data(), count);
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * BURST);
+    latencies.report(state);
+}
+
+// BM_RandomSize keeps a window of live allocations of random sizes
+// up to given one and replaces one of them on every iteration
+template<typename A>
+void BM_RandomSize(benchmark::State &state) {
+    constexpr std::size_t WINDOW = 1024;
+    auto maxSize = static_cast<std::size_t>(state.range(0));
+    Random random{42};
+    std::array<void *, WINDOW> window{};
+    std::size_t i = 0;
+
+    Latencies latencies;
+    for (auto _ : state) {
+        auto &slot = window[i++ % WINDOW];
+        auto size = random() % maxSize + 1;
+        latencies.measure([&slot, size] {
+            A::free(slot);
+            slot = A::malloc(size);
+            benchmark::DoNotOptimize(slot);
+        });
+    }
+    for (auto *ptr : window) {
+        A::free(ptr);
+    }
+    state.SetItemsProcessed(state.iterations());
+    latencies.report(state);
+}
+
+// BM_ProducerConsumer allocates memory of given size in one thread
+// and frees it in another one
+template<typename A>
+void BM_ProducerConsumer(benchmark::State &state) {
+    constexpr std::size_t QUEUE = 4096;
+    auto size = static_cast<std::size_t>(state.range(0));
+    std::array<std::atomic<void *>, QUEUE> queue{};
+    std::atomic<bool> done{false};
+
+    std::thread consumer([&queue, &done] {
+        for (std::size_t i = 0;; i = (i + 1) % QUEUE) {
+            void *ptr = nullptr;
+            while ((ptr = queue[i].exchange(nullptr, std::memory_order_acquire)) == nullptr) {
+                if (done.load(std::memory_order_acquire)) {
+                    return;
+                }
+            }
+            A::free(ptr);
+        }
+    });
+
+    std::size_t i = 0;
+    Latencies latencies;
+    for (auto _ : state) {
+        void *ptr = nullptr;
+        latencies.measure([&ptr, size] { ptr = A::malloc(size); });
+        auto &slot = queue[i++ % QUEUE];
+        while (slot.load(std::memory_order_relaxed) != nullptr) {
+            // wait for consumer
+        }
+        slot.store(ptr, std::memory_order_release);
+    }
+
+    // let consumer drain the queue
+    while (std::any_of(queue.begin(), queue.end(), [](auto &slot) { return slot.load() != nullptr; })) {
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+
+    state.SetItemsProcessed(state.iterations());
+    latencies.report(state);
+}
+
+// BM_ReallocGrowth grows memory by doubling from 16 bytes up to given size
+template<typename A>
+void BM_ReallocGrowth(benchmark::State &state) {
+    auto maxSize = static_cast<std::size_t>(state.range(0));
+    std::size_t reallocs = 0;
+    Latencies latencies;
+    for (auto _ : state) {
+        void *ptr = A::malloc(16);
+        for (std::size_t size = 32; size <= maxSize; size *= 2, ++reallocs) {
+            latencies.measure([&ptr, size] { ptr = A::realloc(ptr, size); });
+            // touch the end, so that growth is not optimized by lazy mapping
+            static_cast<char *>(ptr)[size - 1] = 1;
+        }
+        A::free(ptr);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(reallocs));
+    latencies.report(state);
+}
+
+// BM_AlignedAlloc allocates and frees memory of twice given alignment
+template<typename A>
+void BM_AlignedAlloc(benchmark::State &state) {
+    auto alignment = static_cast<std::size_t>(state.range(0));
+    Latencies latencies;
+    for (auto _ : state) {
+        latencies.measure([alignment] {
+            void *ptr = A::aligned_alloc(alignment, 2 * alignment);
+            benchmark::DoNotOptimize(ptr);
+            A::free(ptr);
+        });
+    }
+    state.SetItemsProcessed(state.iterations());
+    latencies.report(state);
+}
+
+} // namespace
+
+BENCHMARK(BM_Placement)->Arg(0)->Arg(1)->Arg(2)->Iterations(1 << 18);
+
+BENCHMARK_TEMPLATE(BM_Burst, Hse)->Arg(64)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_Burst, System)->Arg(64)->Arg(4096);
+
+BENCHMARK_TEMPLATE(BM_FixedSize, Hse)->RangeMultiplier(8)->Range(16, 1 << 20);
+BENCHMARK_TEMPLATE(BM_FixedSize, System)->RangeMultiplier(8)->Range(16, 1 << 20);
+
+BENCHMARK_TEMPLATE(BM_NewDelete, Hse)->Arg(16)->Arg(64)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_NewDelete, System)->Arg(16)->Arg(64)->Arg(1024);
+
+BENCHMARK_TEMPLATE(BM_RandomSize, Hse)->Arg(256)->Arg(4096)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_RandomSize, System)->Arg(256)->Arg(4096)->Arg(1 << 16);
+
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, Hse)->Arg(64)->Arg(4096)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, System)->Arg(64)->Arg(4096)->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_ReallocGrowth, Hse)->Arg(1 << 16)->Arg(1 << 24);
+BENCHMARK_TEMPLATE(BM_ReallocGrowth, System)->Arg(1 << 16)->Arg(1 << 24);
+
+BENCHMARK_TEMPLATE(BM_AlignedAlloc, Hse)->RangeMultiplier(16)->Range(64, 1 << 16);
+BENCHMARK_TEMPLATE(BM_AlignedAlloc, System)->RangeMultiplier(16)->Range(64, 1 << 16);
+
+BENCHMARK_MAIN();
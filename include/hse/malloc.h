@@ -0,0 +1,76 @@
+#ifndef MALLOC_H
+#define MALLOC_H
+
+#ifdef __cplusplus
+#if (__cplusplus >= 201103L) // C++11
+#define __NOEXCEPT__ noexcept
+#define __NODISCARD__ [[nodiscard]]
+#else
+#define __NOEXCEPT__ throw()
+#define __NODISCARD__
+#endif
+#else
+#define __NOEXCEPT__ /* Ignore */
+#define __NODISCARD__
+#endif
+
+#ifdef __cplusplus
+#include <cstddef> // NOLINT(llvmlibc-restrict-system-libc-headers)
+
+namespace std { // NOLINT(cert-dcl58-cpp)
+extern "C" {
+#endif              // __cplusplus
+#include <stddef.h> // NOLINT(llvmlibc-restrict-system-libc-headers)
+
+__NODISCARD__ void *malloc(size_t) __NOEXCEPT__;
+__NODISCARD__ void *calloc(size_t count, size_t size) __NOEXCEPT__;
+__NODISCARD__ void *realloc(void *ptr, size_t size) __NOEXCEPT__;
+__NODISCARD__ void *aligned_alloc(size_t alignment, size_t size) __NOEXCEPT__;
+__NODISCARD__ int posix_memalign(void **memptr, size_t alignment, size_t size) __NOEXCEPT__;
+__NODISCARD__ void *memalign(size_t alignment, size_t size) __NOEXCEPT__;
+__NODISCARD__ void *valloc(size_t size) __NOEXCEPT__;
+__NODISCARD__ void *pvalloc(size_t size) __NOEXCEPT__;
+void free(void *) __NOEXCEPT__;
+void free_sized(void *ptr, size_t size) __NOEXCEPT__;
+void free_aligned_sized(void *ptr, size_t alignment, size_t size) __NOEXCEPT__;
+__NODISCARD__ size_t malloc_usable_size(void *ptr) __NOEXCEPT__;
+
+/* hse_malloc_batch allocates count blocks of given size to ptrs
+   and returns the number of allocated ones */
+__NODISCARD__ size_t hse_malloc_batch(size_t size, size_t count, void **ptrs) __NOEXCEPT__;
+/* hse_free_batch frees count pointers from ptrs */
+void hse_free_batch(void **ptrs, size_t count) __NOEXCEPT__;
+
+#define HSE_MALLOC_STATS_FREE_RANGES 32
+#define HSE_MALLOC_STATS_SIZE_CLASSES 24
+
+/* hse_malloc_stats describes the state of allocator */
+struct hse_malloc_stats {
+    size_t mapped;     /* pages obtained from the system and not returned yet */
+    size_t retained;   /* released pages retained for reuse */
+    size_t allocated;  /* allocated memory including small slots cached by threads */
+    size_t free_bytes; /* total size of free blocks */
+    double fragmentation; /* share of mapped and not retained memory which is not allocated */
+    size_t mmaps;
+    size_t munmaps;
+    size_t reallocs_in_place;
+    size_t reallocs_remapped;
+    size_t reallocs_copied;
+    int huge_pages;
+    size_t numa_nodes;  /* NUMA nodes with separate arenas */
+    size_t numa_local;  /* frees of small slots owned by the node of the freeing thread */
+    size_t numa_remote; /* frees of small slots owned by other nodes */
+    size_t free_blocks[HSE_MALLOC_STATS_FREE_RANGES]; /* free blocks with size in [2^i, 2^(i+1)) */
+    size_t slots[HSE_MALLOC_STATS_SIZE_CLASSES];      /* allocated slots of every small size class */
+};
+
+void hse_malloc_stats_get(struct hse_malloc_stats *stats) __NOEXCEPT__;
+void malloc_stats(void) __NOEXCEPT__;
+
+#ifdef __cplusplus
+} // extern "C"
+} // namespace std
+
+#endif // __cplusplus
+
+#endif // MALLOC_H
@@ -0,0 +1,241 @@
+#include <math/math.h>
+#include <memory/allocator.h>
+#include <memory/memory_control_block.h>
+#include <memory/stats.h>
+#include <trace/trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using hse::memory::MemoryControlBlock;
+using hse::trace::Header;
+using hse::trace::Op;
+using hse::trace::Record;
+
+// TraceReader reads records of trace file in order of calls through
+// a small buffer, so that memory of the replay is not taken by the trace
+class TraceReader {
+    static constexpr std::size_t BUFFER_RECORDS = 4096;
+
+    std::ifstream file_;
+    std::uint64_t capacity_ = 0;
+
+    // next_ and end_ are numbers of the next buffered and the last records
+    std::uint64_t next_ = 0;
+    std::uint64_t end_ = 0;
+    std::uint64_t size_ = 0;
+
+    std::vector<Record> buffer_;
+    std::size_t pos_ = 0;
+
+    // refill reads the next records of the ring to the buffer
+    void refill() {
+        auto index = this->next_ % this->capacity_;
+        auto count = std::min<std::uint64_t>({BUFFER_RECORDS, this->end_ - this->next_, this->capacity_ - index});
+        this->buffer_.resize(count);
+        this->file_.seekg(static_cast<std::streamoff>(sizeof(Header) + index * sizeof(Record)));
+        this->file_.read(reinterpret_cast<char *>(this->buffer_.data()), static_cast<std::streamsize>(count * sizeof(Record)));
+        if (!this->file_) {
+            throw std::runtime_error("trace file is truncated");
+        }
+        this->next_ += count;
+        this->pos_ = 0;
+    }
+
+  public:
+    explicit TraceReader(const char *path) : file_(path, std::ios::binary) {
+        if (!this->file_) {
+            throw std::runtime_error(std::string{"can not open "} + path);
+        }
+
+        std::uint64_t magic = 0;
+        std::uint64_t head = 0;
+        this->file_.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+        this->file_.read(reinterpret_cast<char *>(&this->capacity_), sizeof(this->capacity_));
+        this->file_.read(reinterpret_cast<char *>(&head), sizeof(head));
+        if (!this->file_ || magic != Header::MAGIC || this->capacity_ == 0) {
+            throw std::runtime_error(std::string{path} + " is not a trace file");
+        }
+
+        // only the last capacity records are kept
+        this->next_ = head > this->capacity_ ? head - this->capacity_ : 0;
+        this->end_ = head;
+        this->size_ = this->end_ - this->next_;
+        this->buffer_.reserve(BUFFER_RECORDS);
+    }
+
+    // size returns the number of records in the trace
+    [[nodiscard]] std::uint64_t size() const noexcept { return this->size_; }
+
+    // next stores the next record to given one and returns false
+    // if there are no more records
+    bool next(Record &record) {
+        if (this->pos_ == this->buffer_.size()) {
+            if (this->next_ == this->end_) {
+                return false;
+            }
+            this->refill();
+        }
+        record = this->buffer_[this->pos_++];
+        return true;
+    }
+};
+
+// statusKiB returns value of given field of /proc/self/status in KiB
+// or zero if there is no such field
+std::size_t statusKiB(const std::string &field) {
+    std::ifstream status("/proc/self/status");
+    for (std::string name; status >> name;) {
+        if (name == field + ":") {
+            std::size_t value = 0;
+            status >> value;
+            return value;
+        }
+        status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return 0;
+}
+
+// resetPeakRSS sets peak resident size of the process to the current one
+// and returns false if the system does not allow it
+bool resetPeakRSS() {
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5" << std::flush;
+    return static_cast<bool>(clearRefs);
+}
+
+// RSS_SAMPLE_EVERY is a number of operations between samples of RSS
+constexpr std::size_t RSS_SAMPLE_EVERY = 4096;
+
+// alignedSize returns size rounded up as Allocator requires
+std::size_t alignedSize(std::uint64_t size) {
+    return hse::math::roundUp(std::max<std::size_t>(size, 1), MemoryControlBlock::ALIGNMENT);
+}
+
+} // namespace
+
+// malloc_replay feeds calls recorded to trace file into Allocator
+// in order of calls from a single thread and reports throughput and
+// peak memory usage. Peak RSS is counted from RSS of the process right
+// before the replay, so that it does not include memory of the replay
+// itself, which is a small buffer of records and a map of live pointers.
+// Pointers recorded before the oldest kept record are unknown,
+// so their frees are skipped. Allocations of recorded pointers which
+// are still live mean that records of threads are out of order,
+// which is reported as a failure.
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : hse::trace::DEFAULT_PATH;
+
+    try {
+        TraceReader trace(path);
+
+        static hse::memory::Allocator allocator;
+        // recorded pointers mapped to replayed ones
+        std::unordered_map<std::uint64_t, std::uintptr_t> ptrs;
+        ptrs.reserve(trace.size());
+        // blocks moved by the last REALLOC of threads until their MOVED
+        std::unordered_map<std::uint16_t, std::uintptr_t> moving;
+
+        using hse::memory::Stats;
+        // replay runs in a single thread, so its shard follows mapped memory
+        auto mappedBefore = Stats::getLocal(Stats::mapped);
+        std::size_t peakMapped = 0;
+        std::size_t ops = 0;
+        std::size_t conflicts = 0;
+
+        // allocated maps recorded pointer to replayed one
+        auto allocated = [&ptrs, &conflicts](std::uint64_t recorded, std::uintptr_t replayed) {
+            if (!ptrs.emplace(recorded, replayed).second) {
+                ++conflicts;
+                ptrs[recorded] = replayed;
+            }
+        };
+
+        // RSS is sampled if its peak can not be reset
+        auto rssBefore = statusKiB("VmRSS");
+        auto resetPeak = resetPeakRSS();
+        auto peakRSS = rssBefore;
+
+        auto start = std::chrono::steady_clock::now();
+        for (Record record{}; trace.next(record);) {
+            if (record.op != Op::FREE && record.result == 0) {
+                // call has failed
+                continue;
+            }
+
+            switch (record.op) {
+            case Op::MALLOC:
+                allocated(record.result, allocator.alloc(alignedSize(record.size), MemoryControlBlock::ALIGNMENT));
+                break;
+            case Op::CALLOC:
+                allocated(record.result, allocator.calloc(alignedSize(record.size)));
+                break;
+            case Op::ALIGNED_ALLOC:
+                allocated(record.result, allocator.alloc(alignedSize(record.size),
+                    std::max<std::size_t>(record.alignment, MemoryControlBlock::ALIGNMENT)));
+                break;
+            case Op::REALLOC: {
+                std::uintptr_t ptr = 0;
+                if (auto it = ptrs.find(record.ptr); it != ptrs.end()) {
+                    ptr = it->second;
+                    ptrs.erase(it);
+                }
+                auto moved = allocator.realloc(ptr, alignedSize(record.size));
+                if (record.result == record.ptr) {
+                    allocated(record.result, moved);
+                } else {
+                    moving[record.thread] = moved;
+                }
+                break;
+            }
+            case Op::MOVED:
+                // it completes the last REALLOC of the thread
+                if (auto it = moving.find(record.thread); it != moving.end()) {
+                    allocated(record.result, it->second);
+                    moving.erase(it);
+                }
+                continue;
+            case Op::FREE:
+                if (auto it = ptrs.find(record.ptr); it != ptrs.end()) {
+                    allocator.free(it->second);
+                    ptrs.erase(it);
+                }
+                break;
+            }
+            ++ops;
+            peakMapped = std::max(peakMapped, Stats::getLocal(Stats::mapped) - mappedBefore);
+            if (!resetPeak && ops % RSS_SAMPLE_EVERY == 0) {
+                peakRSS = std::max(peakRSS, statusKiB("VmRSS"));
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        peakRSS = resetPeak ? statusKiB("VmHWM") : std::max(peakRSS, statusKiB("VmRSS"));
+
+        std::cout << "records:     " << trace.size() << '\n'
+                  << "operations:  " << ops << '\n'
+                  << "elapsed:     " << elapsed.count() << " s\n"
+                  << "throughput:  " << static_cast<double>(ops) / elapsed.count() << " ops/s\n"
+                  << "peak mapped: " << peakMapped << " bytes\n"
+                  << "peak RSS:    " << (peakRSS > rssBefore ? peakRSS - rssBefore : 0) << " KiB\n"
+                  << "conflicts:   " << conflicts << '\n';
+        if (conflicts != 0) {
+            std::cerr << "malloc_replay: live pointers are allocated again, records are out of order" << std::endl;
+            return 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "malloc_replay: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include "config.h"
+#include "memory/memory_control_block_list.h"
+#include "random/random.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+#include <string_view>
+
+namespace hse::config {
+
+namespace {
+
+// State is a state of parsing of configuration from the environment
+enum class State : std::uint8_t {
+    UNPARSED,
+    PARSING,
+    PARSED,
+};
+
+std::atomic<State> state{State::UNPARSED};
+Config config;
+
+// warn reports ignored option to stderr without allocating memory
+void warn(std::string_view option) noexcept {
+    constexpr std::string_view PREFIX = "hse_malloc: ignoring option in HSE_MALLOC_CONF: ";
+    ::write(STDERR_FILENO, PREFIX.data(), PREFIX.size());
+    ::write(STDERR_FILENO, option.data(), option.size());
+    ::write(STDERR_FILENO, "\n", 1);
+}
+
+// parseNumber parses decimal number with optional k, m or g suffix
+// if size is true
+std::optional<std::size_t> parseNumber(std::string_view value, bool size) noexcept {
+    if (value.empty()) {
+        return std::nullopt;
+    }
+
+    std::size_t shift = 0;
+    if (size) {
+        switch (value.back()) {
+        case 'k': case 'K': shift = 10; break;
+        case 'm': case 'M': shift = 20; break;
+        case 'g': case 'G': shift = 30; break;
+        default: break;
+        }
+        if (shift != 0) {
+            value.remove_suffix(1);
+        }
+    }
+    if (value.empty()) {
+        return std::nullopt;
+    }
+
+    std::size_t number = 0;
+    for (auto c : value) {
+        if (c < '0' || c > '9' || number > (std::numeric_limits<std::size_t>::max() - 9) / 10) {
+            return std::nullopt;
+        }
+        number = number * 10 + static_cast<std::size_t>(c - '0');
+    }
+    if (number > (std::numeric_limits<std::size_t>::max() >> shift)) {
+        return std::nullopt;
+    }
+    return number << shift;
+}
+
+std::optional<bool> parseBool(std::string_view value) noexcept {
+    if (value == "true" || value == "1") {
+        return true;
+    }
+    if (value == "false" || value == "0") {
+        return false;
+    }
+    return std::nullopt;
+}
+
+std::optional<Randomization> parseRandom(std::string_view value) noexcept {
+    if (value == "none") {
+        return Randomization::NONE;
+    }
+    if (value == "shift") {
+        return Randomization::SHIFT;
+    }
+    if (value == "slots") {
+        return Randomization::SLOTS;
+    }
+    if (auto enabled = parseBool(value); enabled.has_value()) {
+        if (!*enabled) {
+            return Randomization::NONE;
+        }
+        // compiled mode is kept unless it is disabled
+        auto mode = randomization();
+        return mode == Randomization::NONE ? Randomization::SHIFT : mode;
+    }
+    return std::nullopt;
+}
+
+std::optional<memory::Placement> parsePlacement(std::string_view value) noexcept {
+    if (value == "lifo") {
+        return memory::Placement::LIFO;
+    }
+    if (value == "address") {
+        return memory::Placement::ADDRESS;
+    }
+    if (value == "best") {
+        return memory::Placement::BEST;
+    }
+    return std::nullopt;
+}
+
+// set sets given option to given value if it is valid and returns
+// if it is, so that invalid values keep earlier ones
+template<typename T, typename U>
+bool set(T &option, const std::optional<U> &value) noexcept {
+    if (!value.has_value()) {
+        return false;
+    }
+    option = *value;
+    return true;
+}
+
+// apply sets option with given key to given value and returns
+// false if either of them is invalid, in which case option is not changed
+bool apply(Config &conf, std::string_view key, std::string_view value) noexcept {
+    if (key == "random") {
+        return set(conf.random, parseRandom(value));
+    }
+    if (key == "mmap_threshold") {
+        return set(conf.mmapThreshold, parseNumber(value, true));
+    }
+    if (key == "retained_limit") {
+        return set(conf.retainedLimit, parseNumber(value, true));
+    }
+    if (key == "decay_ms") {
+        auto decay = parseNumber(value, false);
+        if (decay.has_value()) {
+            conf.decay = std::chrono::milliseconds(*decay);
+        }
+        return decay.has_value();
+    }
+    if (key == "arenas") {
+        auto arenas = parseNumber(value, false);
+        if (arenas.value_or(0) == 0) {
+            return false;
+        }
+        conf.arenas = arenas;
+        return true;
+    }
+    if (key == "deferred_coalescing") {
+        return set(conf.deferredCoalescing, parseBool(value));
+    }
+    if (key == "placement") {
+        return set(conf.placement, parsePlacement(value));
+    }
+    if (key == "huge_pages") {
+        return set(conf.hugePages, parseBool(value));
+    }
+    if (key == "stats_print") {
+        return set(conf.statsPrint, parseBool(value));
+    }
+    return false;
+}
+
+} // namespace
+
+Config parse(const char *conf) noexcept {
+    Config result;
+    std::string_view rest = conf != nullptr ? conf : "";
+    while (!rest.empty()) {
+        auto end = rest.find(',');
+        auto option = rest.substr(0, end);
+        rest = end == std::string_view::npos ? std::string_view{} : rest.substr(end + 1);
+        if (option.empty()) {
+            continue;
+        }
+
+        auto colon = option.find(':');
+        if (colon == std::string_view::npos
+            || !apply(result, option.substr(0, colon), option.substr(colon + 1))) {
+            warn(option);
+        }
+    }
+    return result;
+}
+
+const Config &get() noexcept {
+    auto current = state.load(std::memory_order_acquire);
+    if (current == State::UNPARSED && state.compare_exchange_strong(current, State::PARSING)) {
+        // environment is read without allocating memory
+        config = parse(std::getenv(ENV));
+        state.store(State::PARSED, std::memory_order_release);
+    }
+
+    while (state.load(std::memory_order_acquire) != State::PARSED) {
+        // wait for another thread parsing the configuration
+    }
+    return config;
+}
+
+} // namespace hse::config
@@ -0,0 +1,69 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "memory/memory_control_block_list.h"
+#include "random/random.h"
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+namespace hse::config {
+
+// ENV is an environment variable holding configuration string
+constexpr const char *ENV = "HSE_MALLOC_CONF";
+
+// Config holds tunables of allocator. Tunables which are not set
+// keep their compiled defaults.
+struct Config {
+    // random is a randomization mode
+    std::optional<Randomization> random;
+
+    // mmapThreshold is a size starting from which allocations
+    // are mapped separately
+    std::optional<std::size_t> mmapThreshold;
+
+    // retainedLimit is a maximum size of released pages retained
+    // for reuse by every arena
+    std::optional<std::size_t> retainedLimit;
+
+    // decay is a time for which released pages are retained
+    std::optional<std::chrono::milliseconds> decay;
+
+    // arenas is a number of arenas
+    std::optional<std::size_t> arenas;
+
+    // deferredCoalescing enables caching of freed blocks
+    // without merging them with their neighbors
+    std::optional<bool> deferredCoalescing;
+
+    // placement is a policy of choosing a free block for allocation
+    std::optional<memory::Placement> placement;
+
+    // hugePages enables mapping of pages backed by transparent huge pages
+    std::optional<bool> hugePages;
+
+    // statsPrint enables printing of statistics to stderr at exit
+    bool statsPrint = false;
+};
+
+// parse parses configuration string of comma separated key:value pairs:
+//   random:none|shift|slots|true|false
+//   mmap_threshold:<size>     sizes take an optional k, m or g suffix
+//   retained_limit:<size>
+//   decay_ms:<milliseconds>
+//   arenas:<count>
+//   deferred_coalescing:true|false
+//   placement:lifo|address|best
+//   huge_pages:true|false
+//   stats_print:true|false
+// Unknown keys and invalid values are reported to stderr and ignored.
+// It never allocates memory, so it can be called from malloc.
+[[nodiscard]] Config parse(const char *conf) noexcept;
+
+// get returns configuration parsed from ENV on the first call
+[[nodiscard]] const Config &get() noexcept;
+
+} // namespace hse::config
+
+#endif // CONFIG_H
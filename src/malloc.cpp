@@ -1,22 +1,63 @@
 #include "malloc.h"
+#include "config/config.h"
 #include "math/math.h"
 #include "memory/allocator.h"
+#include "memory/arenas.h"
+#include "memory/memory_control_block.h"
+#include "memory/size_class.h"
+#include "memory/stats.h"
+#include "memory/thread_cache.h"
+#include "system/system.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cerrno>
 #include <cstddef> // NOLINT(llvmlibc-restrict-system-libc-headers)
 #include <cstdint>
-#include <numeric>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <span>
+#include <unistd.h>
 
 #ifdef HSE_MALLOC_DEBUG
-#include <unistd.h>
 #define DEBUG_LOG(msg) ::write(2, msg "\n", sizeof(msg));
 #else
 #define DEBUG_LOG(msg) /* Ignore */
 #endif
 
+#ifdef HSE_MALLOC_TRACE
+#include "trace/trace.h"
+#define TRACE(op, ptr, result, size, alignment) \
+    trace::record(trace::Op::op, reinterpret_cast<std::uintptr_t>(ptr), \
+        reinterpret_cast<std::uintptr_t>(result), size, alignment);
+#define TRACE_RESERVE(record) auto *record = trace::reserve();
+#define TRACE_FILL(record, op, ptr, result, size, alignment) \
+    trace::fill(record, trace::Op::op, reinterpret_cast<std::uintptr_t>(ptr), \
+        reinterpret_cast<std::uintptr_t>(result), size, alignment);
+#else
+#define TRACE(op, ptr, result, size, alignment) /* Ignore */
+#define TRACE_RESERVE(record) /* Ignore */
+#define TRACE_FILL(record, op, ptr, result, size, alignment) /* Ignore */
+#endif
+
 namespace hse {
 
-static hse::memory::Allocator _allocator{};
+static_assert(STATS_FREE_RANGES == memory::Stats::FREE_RANGES);
+static_assert(STATS_SIZE_CLASSES == memory::SIZE_CLASSES);
+
+// _arenas holds an arena for every NUMA node
+constinit static hse::memory::Arenas _arenas{};
+
+// _cache serves small allocations of current thread without taking
+// the lock of its arena
+constinit static thread_local hse::memory::ThreadCache _cache{_arenas};
+
+// BATCH_SIZE is a number of pointers passed to arenas at once
+// by malloc_batch and free_batch
+constexpr std::size_t BATCH_SIZE = 64;
 
 void *malloc(std::size_t size) noexcept {
     DEBUG_LOG("MALLOC");
@@ -25,7 +66,9 @@ void *malloc(std::size_t size) noexcept {
     }
 
     try {
-        return reinterpret_cast<void *>(_allocator.alloc(math::roundUp(size, 2), 1));
+        auto *ptr = reinterpret_cast<void *>(_cache.alloc(size));
+        TRACE(MALLOC, nullptr, ptr, size, 0)
+        return ptr;
     } catch (...) {
         return nullptr;
     }
@@ -37,25 +80,163 @@ void free(void *ptr) noexcept {
         return;
     }
 
+    TRACE(FREE, ptr, nullptr, 0, 0)
     try {
-        _allocator.free(reinterpret_cast<std::uintptr_t>(ptr));
+        _cache.free(reinterpret_cast<std::uintptr_t>(ptr));
     } catch (...) {
     }
 }
 
+namespace {
+
+// allocOrThrow returns memory of given size allocated by malloc. On failure
+// it calls the new handler and retries, or throws std::bad_alloc
+// if there is no handler, as throwing operator new does
+[[gnu::noinline]] void *allocOrThrow(std::size_t size) {
+    while (true) {
+        if (void *ptr = malloc(size); ptr != nullptr) {
+            return ptr;
+        }
+        auto handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc{};
+        }
+        handler();
+    }
+}
+
+} // namespace
+
+void *operator_new(std::size_t size) {
+    DEBUG_LOG("OPERATOR_NEW");
+    if (auto slot = _cache.tryAlloc(size); slot != 0) {
+        auto *ptr = reinterpret_cast<void *>(slot);
+        TRACE(MALLOC, nullptr, ptr, size, 0)
+        return ptr;
+    }
+    // operator new returns a distinct pointer even for zero size
+    return allocOrThrow(std::max<std::size_t>(size, 1));
+}
+
+void operator_delete(void *ptr, std::size_t size) noexcept {
+    DEBUG_LOG("OPERATOR_DELETE");
+    if (ptr == nullptr) {
+        return;
+    }
+
+    size = std::max<std::size_t>(size, 1);
+    if (_cache.tryFreeSized(reinterpret_cast<std::uintptr_t>(ptr), size)) {
+        TRACE(FREE, ptr, nullptr, size, 0)
+        return;
+    }
+    free_sized(ptr, size);
+}
+
+std::size_t malloc_batch(std::size_t size, std::size_t count, void **ptrs) noexcept {
+    DEBUG_LOG("MALLOC_BATCH");
+    if (size == 0) {
+        return 0;
+    }
+
+    std::array<std::uintptr_t, BATCH_SIZE> batch{};
+    std::size_t allocated = 0;
+    try {
+        auto &arena = _arenas.local();
+        auto alignedSize = math::roundUp(size, memory::MemoryControlBlock::ALIGNMENT);
+        while (allocated < count) {
+            auto requested = std::min(batch.size(), count - allocated);
+            auto n = arena.allocBatch(alignedSize, std::span{batch.data(), requested});
+            for (std::size_t i = 0; i < n; ++i) {
+                ptrs[allocated + i] = reinterpret_cast<void *>(batch[i]);
+                TRACE(MALLOC, nullptr, ptrs[allocated + i], size, 0)
+            }
+            allocated += n;
+            if (n < requested) {
+                break;
+            }
+        }
+    } catch (...) {
+        // memory ran out before the first block of the batch
+    }
+    return allocated;
+}
+
+void free_batch(void **ptrs, std::size_t count) noexcept {
+    DEBUG_LOG("FREE_BATCH");
+    std::array<std::uintptr_t, BATCH_SIZE> batch{};
+    std::size_t n = 0;
+    try {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (ptrs[i] == nullptr) {
+                continue;
+            }
+
+            TRACE(FREE, ptrs[i], nullptr, 0, 0)
+            batch[n++] = reinterpret_cast<std::uintptr_t>(ptrs[i]);
+            if (n == batch.size()) {
+                _arenas.freeBatch(batch);
+                n = 0;
+            }
+        }
+        _arenas.freeBatch(std::span{batch.data(), n});
+    } catch (...) {
+    }
+}
+
+void free_sized(void *ptr, std::size_t size) noexcept {
+    DEBUG_LOG("FREE_SIZED");
+    if (ptr == nullptr) {
+        return;
+    }
+
+    TRACE(FREE, ptr, nullptr, size, 0)
+    try {
+        _cache.freeSized(reinterpret_cast<std::uintptr_t>(ptr), size);
+    } catch (...) {
+    }
+}
+
+void free_aligned_sized(void *ptr, std::size_t alignment, std::size_t size) noexcept {
+    DEBUG_LOG("FREE_ALIGNED_SIZED");
+    if (ptr == nullptr) {
+        return;
+    }
+
+    TRACE(FREE, ptr, nullptr, size, alignment)
+    try {
+        _cache.freeSized(reinterpret_cast<std::uintptr_t>(ptr), size, alignment);
+    } catch (...) {
+    }
+}
+
+std::size_t malloc_usable_size(void *ptr) noexcept {
+    if (ptr == nullptr) {
+        return 0;
+    }
+    return memory::Allocator::usableSize(reinterpret_cast<std::uintptr_t>(ptr));
+}
+
 void *calloc(std::size_t count, std::size_t size) noexcept {
     DEBUG_LOG("CALLOC");
     if (count == 0 || size == 0) {
         return nullptr;
     }
 
+    if (count > std::numeric_limits<std::size_t>::max() / size) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
     try {
         std::size_t numBytes = count * size;
-        auto *ptr = hse::malloc(numBytes);
-
-        std::iota(reinterpret_cast<std::uint8_t *>(ptr),
-            reinterpret_cast<std::uint8_t *>(ptr) + numBytes,
-            0);
+        void *ptr = nullptr;
+        if (numBytes <= memory::SMALL_SIZE_MAX) {
+            ptr = std::memset(reinterpret_cast<void *>(_cache.alloc(numBytes)), 0, numBytes);
+        } else {
+            ptr = reinterpret_cast<void *>(_arenas.local().calloc(
+                math::roundUp(numBytes, memory::MemoryControlBlock::ALIGNMENT)));
+        }
+        TRACE(CALLOC, nullptr, ptr, numBytes, 0)
         return ptr;
     } catch (...) {
         return nullptr;
@@ -68,13 +249,41 @@ void *realloc(void *ptr, std::size_t size) noexcept {
         return nullptr;
     }
 
+    // the call is recorded before the old block is released and the new
+    // block after it is allocated, as threads reusing them record theirs
+    TRACE_RESERVE(record)
     try {
-        return reinterpret_cast<void *>(_allocator.realloc(reinterpret_cast<std::uintptr_t>(ptr), math::roundUp(size, 2)));
+        auto oldPtr = reinterpret_cast<std::uintptr_t>(ptr);
+        auto &arena = oldPtr == 0 ? _arenas.local() : _arenas.owner(oldPtr);
+        auto *newPtr = reinterpret_cast<void *>(arena.realloc(oldPtr, math::roundUp(size, memory::MemoryControlBlock::ALIGNMENT)));
+        TRACE_FILL(record, REALLOC, ptr, newPtr, size, 0)
+        if (newPtr != ptr) {
+            TRACE(MOVED, ptr, newPtr, size, 0)
+        }
+        return newPtr;
     } catch (...) {
+        TRACE_FILL(record, REALLOC, ptr, nullptr, size, 0)
         return nullptr;
     }
 }
 
+namespace {
+
+// allocAligned returns memory of given size aligned with given alignment
+// or nullptr if memory ran out.
+// NOTE: size should not be zero and alignment should be a power of two
+void *allocAligned(std::size_t alignment, std::size_t size) noexcept {
+    try {
+        auto *ptr = reinterpret_cast<void *>(_cache.alloc(size, alignment));
+        TRACE(ALIGNED_ALLOC, nullptr, ptr, size, alignment)
+        return ptr;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+} // namespace
+
 void *aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
     DEBUG_LOG("ALIGNED_ALLOC");
     if (size == 0 || alignment < sizeof(void*)
@@ -83,11 +292,150 @@ void *aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
         errno = EINVAL;
         return nullptr;
     }
+    return allocAligned(alignment, size);
+}
+
+int posix_memalign(void **memptr, std::size_t alignment, std::size_t size) noexcept {
+    DEBUG_LOG("POSIX_MEMALIGN");
+    if (alignment < sizeof(void*) || !hse::math::isPowerOf2(alignment)) {
+        return EINVAL;
+    }
+    if (size == 0) {
+        *memptr = nullptr;
+        return 0;
+    }
+
+    auto *ptr = allocAligned(alignment, size);
+    if (ptr == nullptr) {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+void *memalign(std::size_t alignment, std::size_t size) noexcept {
+    DEBUG_LOG("MEMALIGN");
+    // alignment which is not a power of two is rounded up as glibc does
+    if (alignment > (std::numeric_limits<std::size_t>::max() >> 1U) + 1) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    if (size == 0) {
+        return nullptr;
+    }
+    return allocAligned(std::bit_ceil(alignment), size);
+}
+
+void *valloc(std::size_t size) noexcept {
+    DEBUG_LOG("VALLOC");
+    if (size == 0) {
+        return nullptr;
+    }
+    return allocAligned(system::PAGE_SIZE(), size);
+}
+
+void *pvalloc(std::size_t size) noexcept {
+    DEBUG_LOG("PVALLOC");
+    // size is rounded up to a whole number of pages, which is at least one
+    auto pageSize = system::PAGE_SIZE();
+    if (size > std::numeric_limits<std::size_t>::max() - pageSize) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    return allocAligned(pageSize, std::max(math::roundUp(size, pageSize), pageSize));
+}
+
+MallocStats malloc_stats_get() noexcept {
+    using memory::Stats;
+
+    MallocStats stats{};
+    stats.mapped = Stats::get(Stats::mapped);
+    stats.allocated = Stats::get(Stats::allocated);
+    stats.mmaps = Stats::get(Stats::mmaps);
+    stats.munmaps = Stats::get(Stats::munmaps);
+    stats.reallocsInPlace = Stats::get(Stats::reallocsInPlace);
+    stats.reallocsRemapped = Stats::get(Stats::reallocsRemapped);
+    stats.reallocsCopied = Stats::get(Stats::reallocsCopied);
+    stats.numaLocal = Stats::get(Stats::numaLocal);
+    stats.numaRemote = Stats::get(Stats::numaRemote);
+    for (std::size_t i = 0; i < stats.slots.size(); ++i) {
+        stats.slots[i] = Stats::get(Stats::slots[i]);
+    }
 
     try {
-        return reinterpret_cast<void *>(_allocator.alloc(size, alignment));
+        auto freeStats = _arenas.freeStats();
+        stats.retained = freeStats.retained;
+        stats.freeBytes = freeStats.freeBytes;
+        stats.freeBlocks = freeStats.freeBlocks;
+        stats.hugePages = _arenas[0].hugePages();
+        stats.numaNodes = _arenas.count();
     } catch (...) {
-        return nullptr;
+        // locking failed, so only counters are reported
+    }
+
+    if (auto used = stats.mapped - stats.retained; stats.mapped > stats.retained && used > stats.allocated) {
+        stats.fragmentation = static_cast<double>(used - stats.allocated) / static_cast<double>(used);
+    }
+    return stats;
+}
+
+namespace {
+
+// printStat writes formatted line to stderr without allocating memory
+template<typename... Args>
+void printStat(const char *format, Args... args) noexcept {
+    std::array<char, 128> line{};
+    if (auto len = std::snprintf(line.data(), line.size(), format, args...); len > 0) {
+        ::write(STDERR_FILENO, line.data(), std::min(static_cast<std::size_t>(len), line.size() - 1));
+    }
+}
+
+// StatsPrinter prints statistics at exit if it is enabled by configuration
+struct StatsPrinter {
+    StatsPrinter() = default;
+    StatsPrinter(const StatsPrinter &) = delete;
+    StatsPrinter &operator=(const StatsPrinter &) = delete;
+
+    ~StatsPrinter() {
+        if (config::get().statsPrint) {
+            malloc_stats();
+        }
+    }
+};
+
+StatsPrinter statsPrinter;
+
+} // namespace
+
+void malloc_stats() noexcept {
+    auto stats = malloc_stats_get();
+    printStat("mapped:            %zu\n", stats.mapped);
+    printStat("retained:          %zu\n", stats.retained);
+    printStat("allocated:         %zu\n", stats.allocated);
+    printStat("free:              %zu\n", stats.freeBytes);
+    printStat("fragmentation:     %zu.%02zu%%\n",
+        static_cast<std::size_t>(stats.fragmentation * 100),
+        static_cast<std::size_t>(stats.fragmentation * 10000) % 100);
+    printStat("mmaps:             %zu\n", stats.mmaps);
+    printStat("munmaps:           %zu\n", stats.munmaps);
+    printStat("reallocs in place: %zu\n", stats.reallocsInPlace);
+    printStat("reallocs remapped: %zu\n", stats.reallocsRemapped);
+    printStat("reallocs copied:   %zu\n", stats.reallocsCopied);
+    printStat("huge pages:        %s\n", stats.hugePages ? "on" : "off");
+    printStat("numa nodes:        %zu\n", stats.numaNodes);
+    if (auto frees = stats.numaLocal + stats.numaRemote; frees != 0) {
+        printStat("numa local frees:  %zu (%zu%%)\n", stats.numaLocal, stats.numaLocal * 100 / frees);
+        printStat("numa remote frees: %zu\n", stats.numaRemote);
+    }
+    for (std::size_t i = 0; i < stats.freeBlocks.size(); ++i) {
+        if (stats.freeBlocks[i] != 0) {
+            printStat("free blocks of 2^%zu: %zu\n", i, stats.freeBlocks[i]);
+        }
+    }
+    for (std::size_t i = 0; i < stats.slots.size(); ++i) {
+        if (stats.slots[i] != 0) {
+            printStat("slots of %zu bytes: %zu\n", memory::classSize(i), stats.slots[i]);
+        }
     }
 }
 
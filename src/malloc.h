@@ -1,15 +1,105 @@
 #ifndef MALLOC_HPP
 #define MALLOC_HPP
 
+#include <array>
 #include <cstddef>
 
 namespace hse {
 
+// STATS_FREE_RANGES is a number of size ranges free blocks are counted in
+constexpr std::size_t STATS_FREE_RANGES = 32;
+
+// STATS_SIZE_CLASSES is a number of small size classes
+constexpr std::size_t STATS_SIZE_CLASSES = 24;
+
+// MallocStats describes the state of allocator
+struct MallocStats {
+    // mapped is a size of pages obtained from the system and not returned yet
+    std::size_t mapped;
+
+    // retained is a size of released pages retained for reuse
+    std::size_t retained;
+
+    // allocated is a size of allocated memory
+    // including small slots cached by threads
+    std::size_t allocated;
+
+    // freeBytes is a total size of free blocks
+    std::size_t freeBytes;
+
+    // fragmentation is a share of mapped and not retained memory
+    // which is not allocated
+    double fragmentation;
+
+    // mmaps and munmaps are numbers of mapped and unmapped ranges
+    std::size_t mmaps;
+    std::size_t munmaps;
+
+    // reallocsInPlace, reallocsRemapped and reallocsCopied are numbers of
+    // reallocations which kept the address, moved pages without copying
+    // and copied data respectively
+    std::size_t reallocsInPlace;
+    std::size_t reallocsRemapped;
+    std::size_t reallocsCopied;
+
+    // hugePages is true if pages are backed by transparent huge pages
+    bool hugePages;
+
+    // numaNodes is a number of NUMA nodes with separate arenas
+    std::size_t numaNodes;
+
+    // numaLocal and numaRemote are numbers of frees of small slots owned
+    // by arena of the node of the freeing thread and by other arenas.
+    // They are counted only if there are several nodes
+    std::size_t numaLocal;
+    std::size_t numaRemote;
+
+    // freeBlocks holds a number of free blocks with size in [2^i, 2^(i+1))
+    // for every i, the last one counts all larger blocks
+    std::array<std::size_t, STATS_FREE_RANGES> freeBlocks;
+
+    // slots holds a number of allocated slots of every small size class
+    std::array<std::size_t, STATS_SIZE_CLASSES> slots;
+};
+
 [[nodiscard]] void* malloc(std::size_t) noexcept;
 [[nodiscard]] void* calloc(std::size_t count, std::size_t size) noexcept;
 [[nodiscard]] void* realloc(void *ptr, std::size_t size) noexcept;
 [[nodiscard]] void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept;
+[[nodiscard]] int posix_memalign(void **memptr, std::size_t alignment, std::size_t size) noexcept;
+[[nodiscard]] void* memalign(std::size_t alignment, std::size_t size) noexcept;
+[[nodiscard]] void* valloc(std::size_t size) noexcept;
+[[nodiscard]] void* pvalloc(std::size_t size) noexcept;
 void free(void *) noexcept;
+void free_sized(void *ptr, std::size_t size) noexcept;
+void free_aligned_sized(void *ptr, std::size_t alignment, std::size_t size) noexcept;
+[[nodiscard]] std::size_t malloc_usable_size(void *ptr) noexcept;
+
+// operator_new allocates memory for global operator new. Small sizes
+// are taken from the cache of current thread inline, without a try block.
+// It never returns nullptr: if memory ran out it calls the new handler
+// and retries, or throws std::bad_alloc if there is no handler
+[[nodiscard]] void* operator_new(std::size_t size);
+
+// operator_delete frees memory of given size allocated by operator_new.
+// Small slots are cached without looking up their spans
+void operator_delete(void *ptr, std::size_t size) noexcept;
+
+// malloc_batch allocates count blocks of given size, stores pointers
+// to them in ptrs and returns the number of allocated blocks, which is
+// less than count only if memory ran out. Blocks are taken from the arena
+// under a single lock and carved out of as few free blocks as possible
+[[nodiscard]] std::size_t malloc_batch(std::size_t size, std::size_t count, void **ptrs) noexcept;
+
+// free_batch frees count pointers from ptrs, which may be nullptr.
+// Adjacent blocks are coalesced together before they are released
+void free_batch(void **ptrs, std::size_t count) noexcept;
+
+// malloc_stats_get returns current statistics of allocator
+[[nodiscard]] MallocStats malloc_stats_get() noexcept;
+
+// malloc_stats prints current statistics of allocator to stderr
+void malloc_stats() noexcept;
 
 } // namespace hse
 
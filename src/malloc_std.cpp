@@ -1,6 +1,8 @@
+#include <hse/malloc.h>
 #include "math/math.h"
 #include "memory/allocator.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstddef>
 #include <cstdint>
@@ -10,8 +12,6 @@
 
 namespace std { // NOLINT(cert-dcl58-cpp)
 
-static hse::memory::Allocator a{};
-
 extern "C" {
 
 void *malloc(size_t size) noexcept { return hse::malloc(size); }
@@ -24,29 +24,163 @@ void *realloc(void *ptr, size_t size) noexcept { return hse::realloc(ptr, size);
 
 void *aligned_alloc(size_t alignment, size_t size) noexcept { return hse::aligned_alloc(alignment, size); }
 
+int posix_memalign(void **memptr, size_t alignment, size_t size) noexcept {
+    return hse::posix_memalign(memptr, alignment, size);
+}
+
+void *memalign(size_t alignment, size_t size) noexcept { return hse::memalign(alignment, size); }
+
+void *valloc(size_t size) noexcept { return hse::valloc(size); }
+
+void *pvalloc(size_t size) noexcept { return hse::pvalloc(size); }
+
+void free_sized(void *ptr, size_t size) noexcept { return hse::free_sized(ptr, size); }
+
+void free_aligned_sized(void *ptr, size_t alignment, size_t size) noexcept {
+    return hse::free_aligned_sized(ptr, alignment, size);
+}
+
+size_t malloc_usable_size(void *ptr) noexcept { return hse::malloc_usable_size(ptr); }
+
+size_t hse_malloc_batch(size_t size, size_t count, void **ptrs) noexcept {
+    return hse::malloc_batch(size, count, ptrs);
+}
+
+void hse_free_batch(void **ptrs, size_t count) noexcept { hse::free_batch(ptrs, count); }
+
+static_assert(HSE_MALLOC_STATS_FREE_RANGES == hse::STATS_FREE_RANGES);
+static_assert(HSE_MALLOC_STATS_SIZE_CLASSES == hse::STATS_SIZE_CLASSES);
+
+void hse_malloc_stats_get(hse_malloc_stats *stats) noexcept {
+    auto s = hse::malloc_stats_get();
+    stats->mapped = s.mapped;
+    stats->retained = s.retained;
+    stats->allocated = s.allocated;
+    stats->free_bytes = s.freeBytes;
+    stats->fragmentation = s.fragmentation;
+    stats->mmaps = s.mmaps;
+    stats->munmaps = s.munmaps;
+    stats->reallocs_in_place = s.reallocsInPlace;
+    stats->reallocs_remapped = s.reallocsRemapped;
+    stats->reallocs_copied = s.reallocsCopied;
+    stats->huge_pages = s.hugePages ? 1 : 0;
+    stats->numa_nodes = s.numaNodes;
+    stats->numa_local = s.numaLocal;
+    stats->numa_remote = s.numaRemote;
+    std::copy(s.freeBlocks.begin(), s.freeBlocks.end(), stats->free_blocks);
+    std::copy(s.slots.begin(), s.slots.end(), stats->slots);
+}
+
+void malloc_stats() noexcept { hse::malloc_stats(); }
+
 } // extern "C"
 } // namespace std
 
-// Should be in global namespace
-// No need to redefine all signatures
-// only for throwing single object declaration
-void *operator new(std::size_t size) {
-    void *ptr = std::malloc(size);
-    if (ptr == nullptr) {
-        throw std::bad_alloc{};
+namespace {
+
+// allocSize returns size to allocate for given requested one,
+// since operator new returns a distinct pointer even for zero size
+std::size_t allocSize(std::size_t size) noexcept {
+    return std::max<std::size_t>(size, 1);
+}
+
+// allocOrThrow returns memory allocated by given function. On failure
+// it calls the new handler and retries, or throws std::bad_alloc
+// if there is no handler, as throwing operator new does
+template<typename F>
+void *allocOrThrow(F alloc) {
+    while (true) {
+        if (void *ptr = alloc(); ptr != nullptr) {
+            return ptr;
+        }
+        auto handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc{};
+        }
+        handler();
     }
 }
 
-void *operator new(std::size_t size, std::align_val_t al) {
-    void *ptr = hse::aligned_alloc(static_cast<std::size_t>(al), size);;
-    if (ptr == nullptr) {
-        throw std::bad_alloc{};
+// allocOrNull returns memory allocated by given function as allocOrThrow
+// does, but returns nullptr instead of throwing
+template<typename F>
+void *allocOrNull(F alloc) noexcept {
+    try {
+        return allocOrThrow(alloc);
+    } catch (...) {
+        return nullptr;
     }
 }
 
-// should be noexcept
-void operator delete(void *ptr) noexcept { std::free(ptr); }
+void *newAligned(std::size_t size, std::align_val_t al) {
+    return allocOrThrow([size, al] { return hse::memalign(static_cast<std::size_t>(al), allocSize(size)); });
+}
+
+void *newPtrNothrow(std::size_t size) noexcept {
+    try {
+        return hse::operator_new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void *newAlignedNothrow(std::size_t size, std::align_val_t al) noexcept {
+    return allocOrNull([size, al] { return hse::memalign(static_cast<std::size_t>(al), allocSize(size)); });
+}
+
+void deleteAlignedSized(void *ptr, std::size_t size, std::align_val_t al) noexcept {
+    hse::free_aligned_sized(ptr, static_cast<std::size_t>(al), allocSize(size));
+}
+
+} // namespace
+
+// Replaceable allocation and deallocation functions
+// should be in global namespace
+
+void *operator new(std::size_t size) { return hse::operator_new(size); }
+
+void *operator new[](std::size_t size) { return hse::operator_new(size); }
+
+void *operator new(std::size_t size, std::align_val_t al) { return newAligned(size, al); }
+
+void *operator new[](std::size_t size, std::align_val_t al) { return newAligned(size, al); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return newPtrNothrow(size); }
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return newPtrNothrow(size); }
+
+void *operator new(std::size_t size, std::align_val_t al, const std::nothrow_t &) noexcept {
+    return newAlignedNothrow(size, al);
+}
+
+void *operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t &) noexcept {
+    return newAlignedNothrow(size, al);
+}
+
+void operator delete(void *ptr) noexcept { hse::free(ptr); }
+
+void operator delete[](void *ptr) noexcept { hse::free(ptr); }
+
+void operator delete(void *ptr, std::size_t size) noexcept { hse::operator_delete(ptr, size); }
+
+void operator delete[](void *ptr, std::size_t size) noexcept { hse::operator_delete(ptr, size); }
+
+void operator delete(void *ptr, std::align_val_t) noexcept { hse::free(ptr); }
+
+void operator delete[](void *ptr, std::align_val_t) noexcept { hse::free(ptr); }
+
+void operator delete(void *ptr, std::size_t size, std::align_val_t al) noexcept {
+    deleteAlignedSized(ptr, size, al);
+}
+
+void operator delete[](void *ptr, std::size_t size, std::align_val_t al) noexcept {
+    deleteAlignedSized(ptr, size, al);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { hse::free(ptr); }
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { hse::free(ptr); }
 
-void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { hse::free(ptr); }
 
-void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { hse::free(ptr); }
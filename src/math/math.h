@@ -3,7 +3,9 @@
 
 #include "concepts/numbers.h"
 
+#include <bit>
 #include <cstdint>
+#include <limits>
 
 namespace hse::math {
 
@@ -26,6 +28,34 @@ constexpr T roundUp(T num, U multiplier) noexcept {
     return roundDown(num + multiplier - 1, multiplier);
 }
 
+// log2 returns binary logarithm of given num rounded down.
+// NOTE: num should not be zero
+template<UnsignedIntegral T>
+constexpr std::uint8_t log2(T num) noexcept {
+    return std::numeric_limits<T>::digits - 1 - std::countl_zero(num);
+}
+
+// mulWide returns high 64 bits of 128-bit product of given numbers
+// and stores low 64 bits of it to low
+constexpr std::uint64_t mulWide(std::uint64_t a, std::uint64_t b, std::uint64_t *low) noexcept {
+#ifdef __SIZEOF_INT128__
+    __extension__ using uint128_t = unsigned __int128;
+    auto product = static_cast<uint128_t>(a) * b;
+    *low = static_cast<std::uint64_t>(product);
+    return static_cast<std::uint64_t>(product >> 64U);
+#else
+    // schoolbook multiplication of 32-bit halves
+    constexpr std::uint64_t MASK = 0xFFFFFFFFU;
+    auto lowLow = (a & MASK) * (b & MASK);
+    auto highLow = (a >> 32U) * (b & MASK);
+    auto lowHigh = (a & MASK) * (b >> 32U);
+    auto highHigh = (a >> 32U) * (b >> 32U);
+    auto middle = (lowLow >> 32U) + (highLow & MASK) + lowHigh;
+    *low = (middle << 32U) | (lowLow & MASK);
+    return highHigh + (highLow >> 32U) + (middle >> 32U);
+#endif
+}
+
 // nthBit returns nth bit of given num, starting from zero
 template<Integral T>
 constexpr bool nthBit(T num, std::uint8_t n) noexcept {
@@ -35,19 +65,19 @@ constexpr bool nthBit(T num, std::uint8_t n) noexcept {
 // setNethBit sets nth bit of given num to 1 starting from zero
 template<Integral T>
 constexpr T setNthBit(T num, std::uint8_t n) noexcept {
-    return num | (1U << n);
+    return num | (T{1} << n);
 }
 
 // clearNethBit sets nth bit of given num to 0 starting from zero
 template<Integral T>
 constexpr T clearNthBit(T num, std::uint8_t n) noexcept {
-    return num & ~(1U << n);
+    return num & ~(T{1} << n);
 }
 
 // toogleNthBit inverts nth bit of given number starting from zero
 template<Integral T>
 constexpr T toogleNthBit(T num, std::uint8_t n) noexcept {
-    return num ^ (1U << n);
+    return num ^ (T{1} << n);
 }
 
 } // namespace hse::math
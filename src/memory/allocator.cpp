@@ -1,30 +1,27 @@
 #include "allocator.h"
 #include "math/math.h"
 #include "memory_control_block.h"
+#include "size_class.h"
+#include "span.h"
 #include "system/system.h"
 
-#ifndef HSE_MALLOC_NO_RANDOM
 #include "random/random.h"
-#include <random>
-#endif
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <limits>
 
 namespace hse::memory {
 
-#ifndef HSE_MALLOC_NO_RANDOM
-sc69069_t Allocator::randomGenerator(std::random_device
-#ifdef HAVE_DEV_URANDOM
-                                                  ("/dev/urandom")
-#else
-                                                  {}
-#endif
-                                                    ());
-#endif
+constexpr MCBPredicate auto mcbFits(std::size_t size) {
+    return [size](const MemoryControlBlock *mcb) noexcept {
+        return mcb->fits(size);
+    };
+}
 
 constexpr MCBPredicate auto Allocator::mcbFitsAlignedData(std::size_t size, std::size_t alignment) {
     return [size, alignment](const MemoryControlBlock *mcb) noexcept {
@@ -33,46 +30,212 @@ constexpr MCBPredicate auto Allocator::mcbFitsAlignedData(std::size_t size, std:
 }
 
 std::uintptr_t Allocator::alloc(std::size_t size, std::size_t alignment) {
+    std::lock_guard lock(this->mutex);
+    return this->allocPtr(size, alignment);
+}
+
+std::uintptr_t Allocator::calloc(std::size_t size) {
+    std::lock_guard lock(this->mutex);
+    if (size <= SMALL_SIZE_MAX) {
+        // it is cheaper to clear small slot than to track it
+        auto ptr = this->slabs.alloc(sizeClass(size));
+        std::memset(reinterpret_cast<void *>(ptr), 0, size);
+        return ptr;
+    }
+
+    bool zeroed = false;
+    auto ptr = size >= this->largeThreshold
+        ? this->large.alloc(size, MemoryControlBlock::ALIGNMENT, &zeroed)
+        : MemoryControlBlock::data(this->allocBlock(size, MemoryControlBlock::ALIGNMENT, &zeroed));
+    if (!zeroed) {
+        std::memset(reinterpret_cast<void *>(ptr), 0, size);
+    }
+    return ptr;
+}
+
+std::size_t Allocator::allocBatch(std::size_t size, std::span<std::uintptr_t> ptrs) {
+    std::lock_guard lock(this->mutex);
+    if (size <= SMALL_SIZE_MAX) {
+        return this->slabs.allocBatch(sizeClass(size), ptrs);
+    }
+
+    for (std::size_t i = 0; i < ptrs.size();) {
+        try {
+            if (size >= this->largeThreshold) {
+                ptrs[i++] = this->large.alloc(size, MemoryControlBlock::ALIGNMENT);
+            } else {
+                i += this->allocBlocks(size, ptrs.subspan(i));
+            }
+        } catch (...) {
+            if (i == 0) {
+                throw;
+            }
+            return i;
+        }
+    }
+    return ptrs.size();
+}
+
+std::uintptr_t Allocator::allocPtr(std::size_t size, std::size_t alignment) {
+    if (hasSizeClass(size, alignment)) {
+        return this->slabs.alloc(alignedSizeClass(size, alignment));
+    }
+    if (size >= this->largeThreshold) {
+        return this->large.alloc(size, alignment);
+    }
     return MemoryControlBlock::data(this->allocBlock(size, alignment));
 }
 
-MemoryControlBlock* Allocator::allocBlock(std::size_t size, std::size_t alignment) {
-    auto *mcb = this->freeBlocks.findPred(mcbFitsAlignedData(size, alignment));
+MemoryControlBlock* Allocator::allocBlock(std::size_t size, std::size_t alignment, bool *zeroed) {
+    // cached blocks would be taken back without a random shift
+    if (auto *mcb = randomization() == Randomization::SHIFT ? nullptr : this->quick.pop(size, alignment);
+        mcb != nullptr) {
+        Stats::add(Stats::allocated, mcb->size());
+        if (zeroed != nullptr) {
+            *zeroed = false;
+        }
+        return mcb;
+    }
+
+    auto fitSize = Allocator::alignedFitSize(size, alignment);
+    auto *mcb = this->freeBlocks.find(size, mcbFitsAlignedData(size, alignment), fitSize);
+    if (mcb == nullptr && !this->quick.empty() && !QuickCache::fits(size)) {
+        // cached blocks can be merged into a large enough one.
+        // Misses of sizes which are cached are served by a new chunk,
+        // so that the cache is not flushed before it is reused
+        this->flushQuick();
+        mcb = this->freeBlocks.find(size, mcbFitsAlignedData(size, alignment), fitSize);
+    }
     if (mcb == nullptr) {
-        mcb = this->allocChunk(size + alignment);
+        mcb = this->allocChunk(fitSize);
+    } else {
+        this->freeBlocks.pop(mcb);
     }
 
     mcb = this->shiftForward(mcb, Allocator::shiftToAlignData(mcb, alignment));
 
-#ifndef HSE_MALLOC_NO_RANDOM
     // check if there is space to prepend with padding block
-    if (mcb->fits(2 + math::roundUp(sizeof(MemoryControlBlock), alignment) + size)) {
-        auto timesAlignment = uniform_int_distribution<std::size_t>
+    if (randomization() == Randomization::SHIFT && mcb->fits(MIN_SHIFT + size)) {
+        auto shift = alignment * uniform_int_distribution<std::size_t>
             (0, (mcb->size() - size) / alignment)
-            (Allocator::randomGenerator);
-        mcb = this->shiftForward(mcb, timesAlignment * alignment);
+            (threadRandom());
+        if (shift >= MIN_SHIFT) {
+            mcb = this->shiftForward(mcb, shift);
+        }
     }
-#endif
 
     mcb->markBusy();
-    this->split(mcb, size);
-    this->freeBlocks.pop(mcb);
+    this->splitFree(mcb, size);
+    Stats::add(Stats::allocated, mcb->size());
+
+    // data of busy block is never known to be zero,
+    // since it can be changed by its owner
+    if (zeroed != nullptr) {
+        *zeroed = mcb->zeroed();
+    }
+    mcb->setZeroed(false);
     return mcb;
 }
 
-std::uintptr_t Allocator::realloc(std::uintptr_t ptr, std::size_t size) { 
+std::size_t Allocator::allocBlocks(std::size_t size, std::span<std::uintptr_t> ptrs) {
+    if (randomization() == Randomization::SHIFT) {
+        // every block is shifted separately
+        ptrs[0] = MemoryControlBlock::data(this->allocBlock(size, MemoryControlBlock::ALIGNMENT));
+        return 1;
+    }
+
+    // carved blocks take no more space than a large allocation
+    constexpr auto HEADER = sizeof(MemoryControlBlock);
+    auto count = std::clamp<std::size_t>(this->largeThreshold / (size + HEADER), 1, ptrs.size());
+    auto total = count * (size + HEADER) - HEADER;
+
+    auto *mcb = this->freeBlocks.find(total, mcbFits(total));
+    if (mcb == nullptr) {
+        mcb = this->allocChunk(total);
+    } else {
+        this->freeBlocks.pop(mcb);
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        mcb->markBusy();
+        MemoryControlBlock *rest = nullptr;
+        if (i + 1 < count) {
+            // rest of the block is carved further, so it is not put
+            // to chain of free blocks
+            rest = this->split(mcb, size);
+        } else {
+            this->splitFree(mcb, size);
+        }
+        Stats::add(Stats::allocated, mcb->size());
+        mcb->setZeroed(false);
+        ptrs[i] = MemoryControlBlock::data(mcb);
+        mcb = rest;
+    }
+    return count;
+}
+
+std::uintptr_t Allocator::realloc(std::uintptr_t ptr, std::size_t size) {
+    std::lock_guard lock(this->mutex);
     if (ptr == reinterpret_cast<std::uintptr_t>(nullptr)) {
         // realloc(nullptr, size) is equal to alloc(size)
-        return this->alloc(size, 1);
+        return this->allocPtr(size, MemoryControlBlock::ALIGNMENT);
+    }
+
+    auto newPtr = this->reallocPtr(ptr, size);
+    if (newPtr == ptr) {
+        Stats::add(Stats::reallocsInPlace, 1);
+    }
+    return newPtr;
+}
+
+std::uintptr_t Allocator::reallocPtr(std::uintptr_t ptr, std::size_t size) {
+    if (auto *span = Span::fromPtr(ptr); span != nullptr) {
+        return span->large()
+            ? this->reallocLarge(span, ptr, size)
+            : this->reallocSlot(span, ptr, size);
     }
-    return MemoryControlBlock::data(this->reallocBlock(MemoryControlBlock::fromDataPtr(ptr), size));
+
+    auto *mcb = MemoryControlBlock::fromDataPtr(ptr);
+    if (size <= SMALL_SIZE_MAX || (size >= this->largeThreshold && !mcb->fits(size))) {
+        // block has become small or large
+        return this->reallocCopy(ptr, mcb->size(), size);
+    }
+    return MemoryControlBlock::data(this->reallocBlock(mcb, size));
+}
+
+std::uintptr_t Allocator::reallocSlot(Span *span, std::uintptr_t ptr, std::size_t size) {
+    if (size <= SMALL_SIZE_MAX && sizeClass(size) == span->sizeClass()) {
+        return ptr;
+    }
+
+    return this->reallocCopy(ptr, span->slotSize(), size);
+}
+
+std::uintptr_t Allocator::reallocLarge(Span *span, std::uintptr_t ptr, std::size_t size) {
+    if (size >= this->largeThreshold) {
+        if (auto newPtr = this->large.realloc(span, ptr, size); newPtr != 0) {
+            if (newPtr != ptr) {
+                Stats::add(Stats::reallocsRemapped, 1);
+            }
+            return newPtr;
+        }
+    }
+    return this->reallocCopy(ptr, LargeAllocator::usableSize(span, ptr), size);
+}
+
+std::uintptr_t Allocator::reallocCopy(std::uintptr_t ptr, std::size_t oldSize, std::size_t size) {
+    auto newPtr = this->allocPtr(size, MemoryControlBlock::ALIGNMENT);
+    std::memcpy(reinterpret_cast<void *>(newPtr), reinterpret_cast<void *>(ptr), std::min(size, oldSize));
+    this->freePtr(ptr);
+    Stats::add(Stats::reallocsCopied, 1);
+    return newPtr;
 }
 
 MemoryControlBlock *Allocator::reallocBlock(MemoryControlBlock *mcb, std::size_t size) {
+    auto oldSize = mcb->size();
     if (mcb->fits(size)) {
-        mcb->markBusy();
-        this->split(mcb, size);
-        this->freeBlocks.pop(mcb);
+        this->splitFree(mcb, size);
+        Stats::sub(Stats::allocated, oldSize - mcb->size());
         return mcb;
     }
 
@@ -80,27 +243,40 @@ MemoryControlBlock *Allocator::reallocBlock(MemoryControlBlock *mcb, std::size_t
     if (auto *next = MemoryControlBlock::next(mcb);
         !next->busy() && size <= mcb->size() + sizeof(MemoryControlBlock) + next->size()) {
         this->absorbNext(mcb);
-        this->split(mcb, size); // mcb can be larger than we need after the absorption
+        this->splitFree(mcb, size); // mcb can be larger than we need after the absorption
+        Stats::add(Stats::allocated, mcb->size() - oldSize);
         return mcb;
     }
 
     auto *oldMCB = mcb;
-    mcb = this->allocBlock(size, 1);
+    mcb = this->allocBlock(size, MemoryControlBlock::ALIGNMENT);
     std::copy(reinterpret_cast<std::uint16_t *>(MemoryControlBlock::data(oldMCB)),
         reinterpret_cast<std::uint16_t *>(MemoryControlBlock::data(oldMCB) + oldMCB->size()),
         reinterpret_cast<std::uint16_t *>(MemoryControlBlock::data(mcb)));
     this->freeBlock(oldMCB);
+    Stats::add(Stats::reallocsCopied, 1);
     return mcb;
 }
 
+std::size_t Allocator::chunkSize(std::size_t size) noexcept {
+    return math::roundUp(sizeof(MemoryControlBlock) + size + sizeof(MemoryControlBlock), system::PAGE_SIZE());
+}
+
 MemoryControlBlock *Allocator::allocChunk(std::size_t size) {
-    std::size_t totalSize = math::roundUp(
-        sizeof(MemoryControlBlock) + size + sizeof(MemoryControlBlock),
-        system::PAGE_SIZE());
+    std::size_t totalSize = Allocator::chunkSize(size);
 
-    auto *mcb = reinterpret_cast<MemoryControlBlock *>(system::mmap(totalSize));
+    bool zeroed = false;
+    auto addr = this->chunks.alloc(totalSize, &zeroed);
+    if (addr == 0) {
+        addr = this->pages.alloc(totalSize);
+        zeroed = true;
+    }
+
+    auto *mcb = reinterpret_cast<MemoryControlBlock *>(addr);
+    mcb->markFree();
     mcb->setSize(totalSize - sizeof(MemoryControlBlock) - sizeof(MemoryControlBlock));
-    this->freeBlocks.prepend(mcb);
+    mcb->setZeroed(zeroed);
+    mcb->setPrev(nullptr);
 
     auto *end = MemoryControlBlock::next(mcb);
     end->setPrev(mcb);
@@ -115,36 +291,16 @@ MemoryControlBlock* Allocator::shiftForward(MemoryControlBlock *mcb, std::size_t
         return mcb;
     }
 
-    if (shift >= sizeof(MemoryControlBlock) + 2) {
-        auto *right = this->split(mcb, shift - sizeof(MemoryControlBlock));
-
-        if (auto *prev = mcb->prev(); prev != nullptr && !prev->busy()) {
-            this->absorbNext(prev);
-        }
-
-        return right;
-    }
-
-    auto storedMCB = *mcb;
-    auto *shiftedMCB = reinterpret_cast<MemoryControlBlock*>(
-           reinterpret_cast<std::uint8_t*>(mcb) + shift);
+    auto *right = this->split(mcb, shift - sizeof(MemoryControlBlock));
 
-    if (this->freeBlocks.first() == mcb) {
-        this->freeBlocks.setFirst(shiftedMCB);
-    }
-
-    MemoryControlBlock::next(mcb)->setPrev(shiftedMCB);
-    auto *prev = mcb->prev();
-    if (prev != nullptr) {
-        prev->grow(shift);
+    if (auto *prev = mcb->prev(); prev != nullptr && !prev->busy()) {
+        this->freeBlocks.pop(prev);
+        Allocator::merge(prev, mcb);
+        mcb = prev;
     }
-    shiftedMCB->setPrev(prev);
-    MemoryControlBlock::setPrevFree(shiftedMCB, storedMCB.prevFree());
-    MemoryControlBlock::setNextFree(shiftedMCB, storedMCB.nextFree());
-    shiftedMCB->setSize(storedMCB.size() - shift);
-    shiftedMCB->setBusy(storedMCB.busy());
+    this->freeBlocks.insert(mcb);
 
-    return shiftedMCB;
+    return right;
 }
 
 MemoryControlBlock* Allocator::split(MemoryControlBlock *mcb, std::size_t size) noexcept {
@@ -152,7 +308,7 @@ MemoryControlBlock* Allocator::split(MemoryControlBlock *mcb, std::size_t size)
         return mcb;
     }
 
-    if (!mcb->fits(size + sizeof(MemoryControlBlock) + 2)) {
+    if (!mcb->fits(size + sizeof(MemoryControlBlock) + MemoryControlBlock::ALIGNMENT)) {
         return mcb;
     }
 
@@ -160,8 +316,14 @@ MemoryControlBlock* Allocator::split(MemoryControlBlock *mcb, std::size_t size)
     mcb->setSize(size);
 
     auto *right = MemoryControlBlock::next(mcb);
+    right->markFree();
     right->setSize(oldSize - size - sizeof(MemoryControlBlock));
+    // header of right block is placed over data of given one,
+    // so data of right block is left untouched
+    right->setZeroed(mcb->zeroed());
     right->setPrev(mcb);
+    MemoryControlBlock::setPrevFree(right, nullptr);
+    MemoryControlBlock::setNextFree(right, nullptr);
 
     auto *next = MemoryControlBlock::next(right);
     next->setPrev(right);
@@ -169,37 +331,216 @@ MemoryControlBlock* Allocator::split(MemoryControlBlock *mcb, std::size_t size)
         this->absorbNext(right);
     }
 
-    this->freeBlocks.prepend(right);
     return right;
 }
 
+void Allocator::splitFree(MemoryControlBlock *mcb, std::size_t size) noexcept {
+    if (auto *right = this->split(mcb, size); right != mcb) {
+        this->freeBlocks.insert(right);
+    }
+}
+
 void Allocator::absorbNext(MemoryControlBlock *mcb) noexcept {
     auto *next = MemoryControlBlock::next(mcb);
     this->freeBlocks.pop(next);
+    Allocator::merge(mcb, next);
+}
+
+void Allocator::merge(MemoryControlBlock *mcb, MemoryControlBlock *next) noexcept {
+    auto zeroed = mcb->zeroed() && next->zeroed();
     MemoryControlBlock::next(next)->setPrev(mcb);
     mcb->grow(sizeof(MemoryControlBlock) + next->size());
+    if (zeroed) {
+        // header of next block becomes a part of data
+        std::memset(next, 0, sizeof(MemoryControlBlock));
+    }
+    mcb->setZeroed(zeroed);
 }
 
 void Allocator::free(std::uintptr_t ptr) {
-    this->freeBlock(MemoryControlBlock::fromDataPtr(ptr));
+    std::lock_guard lock(this->mutex);
+    this->freePtr(ptr);
+}
+
+std::size_t Allocator::usableSize(std::uintptr_t ptr) noexcept {
+    if (auto *span = Span::fromPtr(ptr); span != nullptr) {
+        return span->large()
+            ? LargeAllocator::usableSize(span, ptr)
+            : span->slotSize();
+    }
+    return MemoryControlBlock::fromDataPtr(ptr)->size();
+}
+
+FreeStats Allocator::freeStats() {
+    std::lock_guard lock(this->mutex);
+    FreeStats stats{this->chunks.size(), 0, {}};
+    auto count = [&stats](const MemoryControlBlock *mcb) {
+        stats.freeBytes += mcb->size();
+        ++stats.freeBlocks[Stats::freeRange(mcb->size())];
+    };
+    this->freeBlocks.forEach(count);
+    this->quick.forEach(count);
+    return stats;
+}
+
+bool Allocator::hugePages() {
+    std::lock_guard lock(this->mutex);
+    return this->pages.hugePages();
+}
+
+void Allocator::setHugePages(bool hugePages) {
+    std::lock_guard lock(this->mutex);
+    this->pages.setHugePages(hugePages);
+}
+
+void Allocator::setArena(std::size_t arena, bool bindNode) {
+    std::lock_guard lock(this->mutex);
+    this->pages.setArena(arena, bindNode);
+}
+
+void Allocator::setRetainedLimit(std::size_t limit) {
+    std::lock_guard lock(this->mutex);
+    this->chunks.setLimit(limit);
+}
+
+void Allocator::setDecay(ChunkCache::Clock::duration decay) {
+    std::lock_guard lock(this->mutex);
+    this->chunks.setDecay(decay);
+}
+
+void Allocator::setDeferredCoalescing(bool enabled) {
+    std::lock_guard lock(this->mutex);
+    this->deferCoalescing = enabled;
+    if (!enabled) {
+        this->flushQuick();
+    }
+}
+
+void Allocator::setPlacement(Placement placement) {
+    std::lock_guard lock(this->mutex);
+    this->freeBlocks.setPlacement(placement);
+}
+
+void Allocator::setLargeThreshold(std::size_t threshold) {
+    std::lock_guard lock(this->mutex);
+    this->largeThreshold = std::max(threshold, SMALL_SIZE_MAX + 1);
+}
+
+void Allocator::freeBatch(std::span<const std::uintptr_t> ptrs) {
+    std::array<MemoryControlBlock *, BATCH_BLOCKS> mcbs;
+    std::size_t count = 0;
+
+    std::lock_guard lock(this->mutex);
+    for (auto ptr : ptrs) {
+        if (Span::fromPtr(ptr) != nullptr) {
+            this->freePtr(ptr);
+            continue;
+        }
+
+        auto *mcb = MemoryControlBlock::fromDataPtr(ptr);
+        Stats::sub(Stats::allocated, mcb->size());
+        mcbs[count++] = mcb;
+        if (count == mcbs.size()) {
+            this->freeBlocksSorted(mcbs);
+            count = 0;
+        }
+    }
+    this->freeBlocksSorted(std::span{mcbs.data(), count});
+}
+
+void Allocator::freeRemote(std::span<const std::uintptr_t> ptrs) noexcept {
+    for (auto ptr : ptrs) {
+        this->slabs.freeRemote(Span::fromPtr(ptr), ptr);
+    }
+}
+
+void Allocator::freePtr(std::uintptr_t ptr) {
+    if (auto *span = Span::fromPtr(ptr); span != nullptr) {
+        if (span->large()) {
+            this->large.free(span, ptr);
+        } else {
+            this->slabs.free(span, ptr);
+        }
+        return;
+    }
+    this->freeDeferred(MemoryControlBlock::fromDataPtr(ptr));
+}
+
+void Allocator::freeDeferred(MemoryControlBlock *mcb) {
+    if (!this->deferCoalescing || randomization() == Randomization::SHIFT
+        || !QuickCache::fits(mcb->size())) {
+        this->freeBlock(mcb);
+        return;
+    }
+
+    if (this->quick.full()) {
+        this->flushQuick();
+    }
+    Stats::sub(Stats::allocated, mcb->size());
+    mcb->setZeroed(false);
+    this->quick.push(mcb);
+}
+
+void Allocator::flushQuick() {
+    std::array<MemoryControlBlock *, QuickCache::CAPACITY> mcbs;
+    this->freeBlocksSorted(std::span{mcbs.data(), this->quick.take(mcbs)});
 }
 
 void Allocator::freeBlock(MemoryControlBlock *mcb) {
+    Stats::sub(Stats::allocated, mcb->size());
     mcb->markFree();
-    this->freeBlocks.prepend(mcb);
+    mcb->setZeroed(false);
 
     if (MemoryControlBlock *next = MemoryControlBlock::next(mcb); !next->busy()) {
         this->absorbNext(mcb);
     }
 
     if (MemoryControlBlock *prev = mcb->prev(); prev != nullptr && !prev->busy()) {
+        this->freeBlocks.pop(prev);
+        Allocator::merge(prev, mcb);
         mcb = prev;
+    }
+    this->tryRelease(mcb);
+}
+
+void Allocator::freeBlocksSorted(std::span<MemoryControlBlock *> mcbs) {
+    std::sort(mcbs.begin(), mcbs.end());
+
+    // run is a free block, which is not in chain of free blocks yet
+    MemoryControlBlock *run = nullptr;
+    for (auto *mcb : mcbs) {
+        mcb->markFree();
+        mcb->setZeroed(false);
+
+        if (run != nullptr && MemoryControlBlock::next(run) == mcb) {
+            Allocator::merge(run, mcb);
+            continue;
+        }
+
+        if (run != nullptr) {
+            this->releaseRun(run);
+        }
+        run = mcb;
+        if (auto *prev = mcb->prev(); prev != nullptr && !prev->busy()) {
+            this->freeBlocks.pop(prev);
+            Allocator::merge(prev, mcb);
+            run = prev;
+        }
+    }
+
+    if (run != nullptr) {
+        this->releaseRun(run);
+    }
+}
+
+void Allocator::releaseRun(MemoryControlBlock *mcb) {
+    if (auto *next = MemoryControlBlock::next(mcb); !next->busy()) {
         this->absorbNext(mcb);
     }
-    this->tryUnmap(mcb);
+    this->tryRelease(mcb);
 }
 
-void Allocator::tryUnmap(MemoryControlBlock *mcb) {
+void Allocator::tryRelease(MemoryControlBlock *mcb) {
     std::uintptr_t from = mcb->prev() == nullptr
         // first block in chunk can be not page-aligned
         ? math::roundDown(reinterpret_cast<std::uintptr_t>(mcb), system::PAGE_SIZE())
@@ -214,51 +555,61 @@ void Allocator::tryUnmap(MemoryControlBlock *mcb) {
         : math::roundDown(reinterpret_cast<std::uintptr_t>(next), system::PAGE_SIZE());
 
     if (to < from + system::PAGE_SIZE()) {
-        // there is no free pages to delete
+        // there is no free pages to release
+        this->freeBlocks.insert(mcb);
         return;
     }
 
     if (std::ptrdiff_t diff = from - MemoryControlBlock::data(mcb); diff >= 0) {
         // mcb is not the first in chunk since moved foreward
-        if (diff >= static_cast<std::ptrdiff_t>(sizeof(MemoryControlBlock) + 2)) {
+        if (diff >= static_cast<std::ptrdiff_t>(sizeof(MemoryControlBlock) + MemoryControlBlock::ALIGNMENT)) {
             // there is enough space for non-empty block
             mcb->setSize(diff - sizeof(MemoryControlBlock));
             auto *end = MemoryControlBlock::next(mcb);
             end->setPrev(mcb);
             end->markBusy();
             end->setSize(0);
+            this->freeBlocks.insert(mcb);
         } else {
             // there is no space in current page
             mcb->markBusy();
             mcb->setSize(0);
-            this->freeBlocks.pop(mcb);
         }
-    } else { // block will be removed with pages
-        this->freeBlocks.pop(mcb);
-    }
+    } // else block will be removed with pages
 
     if (std::ptrdiff_t diff = reinterpret_cast<std::uintptr_t>(next) - to; diff >= 0) {
         // next is not the last in chunk since moved backward
-        if (diff >= static_cast<std::ptrdiff_t>(sizeof(MemoryControlBlock) + 2)) {
+        if (diff >= static_cast<std::ptrdiff_t>(sizeof(MemoryControlBlock) + MemoryControlBlock::ALIGNMENT)) {
             // there is enough space for non-empty block
             auto *first = reinterpret_cast<MemoryControlBlock *>(to);
             first->markFree();
-            first->setSize(diff - sizeof(MemoryControlBlock) - sizeof(MemoryControlBlock));
+            first->setSize(diff - sizeof(MemoryControlBlock));
+            first->setZeroed(mcb->zeroed());
             first->setPrev(nullptr);
             next->setPrev(first);
-            this->freeBlocks.prepend(first);
+            this->freeBlocks.insert(first);
         } else {
             // there is no space before next
             next->setPrev(nullptr);
         }
     }
 
-    system::munmap(from, to - from);
+    this->chunks.free(from, to - from);
+}
+
+std::size_t Allocator::alignedFitSize(std::size_t size, std::size_t alignment) noexcept {
+    // shift to align data is less than alignment + MIN_SHIFT
+    return alignment > MemoryControlBlock::ALIGNMENT ? size + alignment + MIN_SHIFT : size;
 }
 
 std::size_t Allocator::shiftToAlignData(const MemoryControlBlock *mcb, std::size_t alignment) noexcept {
     auto data = MemoryControlBlock::data(mcb);
-    return math::roundUp(data, alignment) - data;
+    std::size_t shift = math::roundUp(data, alignment) - data;
+    if (shift != 0 && shift < MIN_SHIFT) {
+        // there should be enough space for padding block
+        shift += math::roundUp(MIN_SHIFT - shift, alignment);
+    }
+    return shift;
 }
 
 } // namespace hse::memory
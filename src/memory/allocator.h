@@ -1,16 +1,19 @@
 #ifndef ALLOCATOR_H
 #define ALLOCATOR_H
 
+#include "chunk_cache.h"
+#include "large_allocator.h"
 #include "memory_control_block.h"
 #include "memory_control_block_list.h"
-
-#ifndef HSE_MALLOC_NO_RANDOM
-#include "random/random.h"
-#endif
+#include "page_source.h"
+#include "quick_cache.h"
+#include "slab_allocator.h"
+#include "stats.h"
 
 #include <cstddef>
 #include <cstdint>
-
+#include <mutex>
+#include <span>
 
 namespace hse::memory {
 
@@ -18,20 +21,81 @@ constexpr MCBPredicate auto mcbFits(std::size_t);
 constexpr MCBPredicate auto mcbFitsAlignedData(std::size_t size, std::size_t alignment);
 
 // Allocator is responsible for managing allocated memory pages and chunks of
-// blocks
+// blocks. Allocations of small sizes are served from slabs without
+// per-block headers, including aligned ones, which take slots of classes
+// aligned with their alignment. Allocations of large sizes are mapped separately.
+// Freed blocks of medium sizes are kept in QuickCache and merged with
+// their neighbors only when it overflows or an allocation misses.
+// It is safe to share single Allocator between threads:
+// every public method holds the lock for the whole call.
 class Allocator {
   private:
+    // MIN_SHIFT is a minimal non-zero shift of block, so that
+    // there is enough space for a non-empty padding block before it
+    static constexpr std::size_t MIN_SHIFT = sizeof(MemoryControlBlock) + MemoryControlBlock::ALIGNMENT;
+
+    // BATCH_BLOCKS is a maximum number of blocks coalesced together by freeBatch
+    static constexpr std::size_t BATCH_BLOCKS = 64;
 
-#ifndef HSE_MALLOC_NO_RANDOM
-    // PRNG generator which is used in every call to random value
-    static sc69069_t randomGenerator;
-#endif
+    std::mutex mutex;
 
     FreeMemoryControlBlockList freeBlocks;
 
+    // quick holds freed blocks which are not merged yet
+    QuickCache quick;
+
+    // deferCoalescing enables caching of freed blocks in quick
+    bool deferCoalescing = true;
+
+    // chunks retains released pages of both chunks and slabs for reuse
+    ChunkCache chunks;
+
+    // pages maps fresh pages when there are no retained ones
+    PageSource pages;
+
+    SlabAllocator slabs{chunks, pages};
+
+    LargeAllocator large{chunks, pages};
+
+    // largeThreshold is a size starting from which allocations
+    // are served by LargeAllocator
+    std::size_t largeThreshold = LargeAllocator::DEFAULT_THRESHOLD;
+
+    // allocPtr returns a pointer to memory of given size with given
+    // alignment either from slabs, from chain of free blocks
+    // or from separately mapped pages
+    [[nodiscard]] std::uintptr_t allocPtr(std::size_t size, std::size_t alignment);
+
+    // freePtr deallocates memory pointed by given pointer
+    void freePtr(std::uintptr_t);
+
+    // reallocPtr reallocates memory pointed by given non-null pointer
+    // for given size
+    [[nodiscard]] std::uintptr_t reallocPtr(std::uintptr_t ptr, std::size_t size);
+
+    // reallocSlot reallocates given slot of given span for given size
+    [[nodiscard]] std::uintptr_t reallocSlot(Span *span, std::uintptr_t ptr, std::size_t size);
+
+    // reallocLarge reallocates large allocation of given span for given size
+    // remapping its pages if it stays large
+    [[nodiscard]] std::uintptr_t reallocLarge(Span *span, std::uintptr_t ptr, std::size_t size);
+
+    // reallocCopy allocates memory of given size, copies there data
+    // of given old size pointed by ptr and frees ptr
+    [[nodiscard]] std::uintptr_t reallocCopy(std::uintptr_t ptr, std::size_t oldSize, std::size_t size);
+
     // allockBlock returns block with given size and data with given alignment
-    // from chain of free blocks or allocates memory for new one if needed. 
-    [[nodiscard]] MemoryControlBlock* allocBlock(std::size_t size, std::size_t alignment);
+    // from chain of free blocks or allocates memory for new one if needed.
+    // If zeroed is not nullptr, it is set to whether data of the block
+    // is known to be filled with zeros.
+    [[nodiscard]] MemoryControlBlock* allocBlock(std::size_t size, std::size_t alignment, bool *zeroed = nullptr);
+
+    // allocBlocks carves blocks of given size for some of given ptrs
+    // out of a single free block or chunk, so that the chain of free blocks
+    // is searched once. It returns the number of allocated blocks,
+    // which is never zero.
+    // NOTE: size should be a multiple of ALIGNMENT
+    [[nodiscard]] std::size_t allocBlocks(std::size_t size, std::span<std::uintptr_t> ptrs);
 
     // realloc(mcb, size) tries to enlarge size of given mcb to given size.
     // If size is less than or equal to current size of mcb,
@@ -42,59 +106,180 @@ class Allocator {
     [[nodiscard]] MemoryControlBlock *reallocBlock(MemoryControlBlock *, std::size_t);
 
     // freeBlock releases block back to chain of blocks,
-    // merges it with its neighbors and unmaps free memory pages
+    // merges it with its neighbors and releases free memory pages
     // within given block
     void freeBlock(MemoryControlBlock *);
 
+    // freeDeferred puts given block to quick cache if it fits there
+    // or releases it with freeBlock otherwise.
+    // Blocks are not cached with SHIFT randomization, since cached ones
+    // are taken back at the same address
+    void freeDeferred(MemoryControlBlock *mcb);
+
+    // flushQuick merges all blocks of quick cache with their neighbors
+    // and puts them to chain of free blocks
+    void flushQuick();
+
+    // freeBlocksSorted releases given busy blocks as freeBlock does,
+    // but adjacent ones are merged with each other before they are put
+    // to chain of free blocks and their pages are released once.
+    // Given blocks are sorted by address.
+    // NOTE: statistics should be updated by the caller
+    void freeBlocksSorted(std::span<MemoryControlBlock *> mcbs);
+
+    // releaseRun merges given free block, which is not in chain
+    // of free blocks, with the next one and releases its pages
+    void releaseRun(MemoryControlBlock *mcb);
+
+    // chunkSize returns the size of chunk holding a single block of given size
+    static std::size_t chunkSize(std::size_t size) noexcept;
+
     // allocChunk allocates memory pages for new block with given size
+    // reusing retained pages if possible.
+    // The block is not put to chain of free blocks
     [[nodiscard]] MemoryControlBlock *allocChunk(std::size_t size);
 
-    // shiftForward shifts given MCB forward
-    // and prepends it with another non-empty MCB if possible.
+    // shiftForward shifts given MCB forward by splitting off
+    // a non-empty padding block before it, which is merged with previous
+    // free block and put to chain of free blocks.
     // It returns pointer to shifted one.
     // Following conditions should be met:
-    // 1. mcb should not be busy
-    // 2. shift should be multiple of 2
-    // 3. mcb->fits(shift + 2)
+    // 1. mcb should not be busy and should not be in chain of free blocks
+    // 2. shift should be zero or multiple of ALIGNMENT not less than MIN_SHIFT
+    // 3. mcb->fits(shift + ALIGNMENT)
+    // Busy blocks are never touched, so their size can be read
+    // by their owner without the lock.
     [[nodiscard]] MemoryControlBlock* shiftForward(MemoryControlBlock* mcb, std::size_t shift) noexcept;
 
-    // split tries to split given block into two blocks,
-    // where first of them has given size.
-    // It prepends right block to chain of free blocks
-    // and tries to absorb the block next to the right one.
-    // It returns pointer to second block in case of split
-    // or pointer to given block otherwise.
-    // NOTE: size should be a multiple of 2
+    // split tries to split given block, which is not in chain
+    // of free blocks, into two blocks, where first of them has given size.
+    // Right block is merged with the next one if it is free.
+    // It returns pointer to right block, which is not put to chain
+    // of free blocks, in case of split or pointer to given block otherwise.
+    // NOTE: size should be a multiple of ALIGNMENT
     MemoryControlBlock* split(MemoryControlBlock *mcb, std::size_t size) noexcept;
 
+    // splitFree splits given block as split does
+    // and puts right block to chain of free blocks
+    void splitFree(MemoryControlBlock *mcb, std::size_t size) noexcept;
+
     // absorbNext removes block next to given from chain of free blocks
     // and absorbs it
     void absorbNext(MemoryControlBlock *mcb) noexcept;
 
-    // tryUnmap tries to unmap memory pages within given block
-    void tryUnmap(MemoryControlBlock *);
+    // merge makes given block absorb the next one, which should be
+    // neither busy nor in chain of free blocks.
+    // Merged block is zeroed only if both of them are zeroed
+    static void merge(MemoryControlBlock *mcb, MemoryControlBlock *next) noexcept;
+
+    // tryRelease tries to release memory pages within given free block,
+    // which is not in chain of free blocks, to chunk cache and puts
+    // what is left of it back to the chain
+    void tryRelease(MemoryControlBlock *);
 
     static constexpr MCBPredicate auto mcbFitsAlignedData(std::size_t size, std::size_t alignment);
+
+    // alignedFitSize returns a size of block, which fits data of given size
+    // aligned with given alignment wherever the block is placed
+    static std::size_t alignedFitSize(std::size_t size, std::size_t alignment) noexcept;
+
     // shiftToAlignData returns how many bytes mcb should be shifted right
-    // to make its data aligned with given alignmebt
+    // to make its data aligned with given alignmebt.
+    // It is either zero or not less than MIN_SHIFT
     static std::size_t shiftToAlignData(const MemoryControlBlock *mcb, std::size_t alignment) noexcept;
   public:
+    constexpr Allocator() noexcept = default;
+
     // alloc(size, alignment) allocates memory of size bytes with specified
     // aligment and returns a pointer to the allocated memory.
-    // NOTE: size should be a multiple of max(2, alignment)
+    // NOTE: size should be a multiple of max(ALIGNMENT, alignment)
     [[nodiscard]] std::uintptr_t alloc(std::size_t size, std::size_t alignment);
 
+    // calloc(size) allocates memory of size bytes filled with zeros
+    // and returns a pointer to it. Memory is cleared only if it is not
+    // known to be zero already, e.g. freshly mapped pages are not touched.
+    // NOTE: size should be a multiple of ALIGNMENT
+    [[nodiscard]] std::uintptr_t calloc(std::size_t size);
+
+    // allocBatch allocates ptrs.size() blocks of given size under a single
+    // lock and stores pointers to them in ptrs. Blocks which are neither
+    // small nor large are carved out of as few free blocks as possible.
+    // It returns the number of
+    // allocated blocks, which is less than ptrs.size() only if memory
+    // ran out in the middle of the batch.
+    // NOTE: size should be a multiple of ALIGNMENT
+    [[nodiscard]] std::size_t allocBatch(std::size_t size, std::span<std::uintptr_t> ptrs);
+
     // realloc(ptr, size) reallocates memory pointed by ptr for given size and
     // returns ptr. If size is less than or equal to current size of allocated
     // memory pointer by ptr, then it shrinks it. If there is not enough room to
     // enlarge memory allocation pointed by ptr, it allocates new allocation,
     // copies the old data pointed to by ptr, frees the old allocation and
     // returns a pointer to allocated memory.
-    // NOTE: size should be a multiple of 2
+    // Small sizes are always moved to slabs, so that memory of small size
+    // is a slot whichever way it was allocated.
+    // NOTE: size should be a multiple of ALIGNMENT
     [[nodiscard]] std::uintptr_t realloc(std::uintptr_t, std::size_t);
 
     // free deallocates memory pointed by given pointer
     void free(std::uintptr_t);
+
+    // freeStats returns description of memory which is mapped
+    // but not allocated
+    [[nodiscard]] FreeStats freeStats();
+
+    // hugePages returns if pages are mapped in regions
+    // backed by transparent huge pages
+    [[nodiscard]] bool hugePages();
+
+    // usableSize returns the size of memory pointed by given pointer,
+    // which can be used by the caller. It does not take the lock,
+    // since size of allocated memory is changed only by its owner
+    [[nodiscard]] static std::size_t usableSize(std::uintptr_t ptr) noexcept;
+
+    // setHugePages enables or disables mapping of pages in regions
+    // backed by transparent huge pages. It should be called at startup,
+    // since it affects only pages mapped afterwards
+    void setHugePages(bool hugePages);
+
+    // setArena makes Allocator an arena with given index, which is
+    // recorded in PageMap for every page mapped afterwards, so that
+    // the arena can be found by any pointer to its memory. Pages are bound
+    // to NUMA node with the same index if bindNode is true.
+    // It should be called before the first allocation.
+    // NOTE: arena should be less than PageMap::MAX_ARENAS
+    void setArena(std::size_t arena, bool bindNode);
+
+    // setRetainedLimit sets maximum total size of released pages
+    // retained for reuse
+    void setRetainedLimit(std::size_t limit);
+
+    // setDecay sets time for which released pages are retained
+    void setDecay(ChunkCache::Clock::duration decay);
+
+    // setDeferredCoalescing enables or disables caching of freed blocks
+    // of medium sizes without merging them with their neighbors.
+    // Cached blocks are merged when it is disabled
+    void setDeferredCoalescing(bool enabled);
+
+    // setPlacement sets policy of choosing a free block for allocation
+    void setPlacement(Placement placement);
+
+    // setLargeThreshold sets a size starting from which allocations are
+    // mapped separately and released at once when freed.
+    // Thresholds not exceeding SMALL_SIZE_MAX are raised above it
+    void setLargeThreshold(std::size_t threshold);
+
+    // freeBatch deallocates memory pointed by every given pointer
+    // under a single lock. Adjacent blocks are coalesced together,
+    // so that every run of them is put to chain of free blocks once
+    void freeBatch(std::span<const std::uintptr_t> ptrs);
+
+    // freeRemote deallocates slots of slabs pointed by given pointers
+    // without taking the lock. They are pushed to lock-free lists of their
+    // spans and returned to them on the next allocation of a slot.
+    // NOTE: every pointer should point to a slot of a slab
+    void freeRemote(std::span<const std::uintptr_t> ptrs) noexcept;
 };
 } // namespace hse::memory
 
@@ -0,0 +1,180 @@
+#include "arenas.h"
+#include "config/config.h"
+#include "page_map.h"
+#include "random/random.h"
+#include "stats.h"
+#include "system/system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+
+namespace hse::memory {
+
+namespace {
+
+// threads is a number of threads which have been assigned a fake node
+std::atomic<std::size_t> threads{0};
+
+// thread is a number of current thread in order of assignment
+// of fake nodes starting from one or zero if it has not been assigned
+constinit thread_local std::size_t thread = 0;
+
+} // namespace
+
+std::size_t Arenas::count() {
+    if (auto count = this->count_.load(std::memory_order_acquire); count != 0) {
+        return count;
+    }
+    return this->init();
+}
+
+std::size_t Arenas::init() {
+    const auto &conf = config::get();
+    if (conf.random.has_value()) {
+        setRandomization(*conf.random);
+    }
+
+    auto nodes = system::nodeCount();
+    auto count = conf.arenas.value_or(nodes);
+    // environment is read without allocating memory
+    if (const char *fakeNodes = std::getenv(NODES_ENV); fakeNodes != nullptr) {
+        if (auto fakeCount = std::strtoul(fakeNodes, nullptr, 10); fakeCount != 0) {
+            count = fakeCount;
+            nodes = 0;
+        }
+    }
+
+    for (std::size_t i = 0; i < std::min(count, MAX_ARENAS); ++i) {
+        this->configure(this->arenas_[i], conf);
+    }
+
+    // arenas which do not match nodes are assigned to threads round-robin
+    auto fake = count != nodes;
+    this->fake_.store(fake, std::memory_order_relaxed);
+    this->setCount(count, !fake && count > 1);
+    return this->count_.load(std::memory_order_acquire);
+}
+
+void Arenas::configure(Allocator &arena, const config::Config &conf) {
+    if (conf.mmapThreshold.has_value()) {
+        arena.setLargeThreshold(*conf.mmapThreshold);
+    }
+    if (conf.retainedLimit.has_value()) {
+        arena.setRetainedLimit(*conf.retainedLimit);
+    }
+    if (conf.decay.has_value()) {
+        arena.setDecay(*conf.decay);
+    }
+    if (conf.deferredCoalescing.has_value()) {
+        arena.setDeferredCoalescing(*conf.deferredCoalescing);
+    }
+    if (conf.placement.has_value()) {
+        arena.setPlacement(*conf.placement);
+    }
+    if (conf.hugePages.has_value()) {
+        arena.setHugePages(*conf.hugePages);
+    }
+}
+
+void Arenas::setCount(std::size_t count, bool bindNodes) {
+    count = std::clamp<std::size_t>(count, 1, MAX_ARENAS);
+    if (count > 1) {
+        // single arena does not need to be found by pointers
+        for (std::size_t i = 0; i < count; ++i) {
+            this->arenas_[i].setArena(i, bindNodes);
+        }
+    }
+
+    // concurrent first calls set the same count
+    std::size_t expected = 0;
+    this->count_.compare_exchange_strong(expected, count, std::memory_order_acq_rel);
+}
+
+std::size_t Arenas::node() {
+    auto count = this->count();
+    if (this->fake_.load(std::memory_order_relaxed)) {
+        if (thread == 0) {
+            thread = threads.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+        return (thread - 1) % count;
+    }
+    return system::currentNode() % count;
+}
+
+Allocator &Arenas::local() {
+    if (this->count() == 1) {
+        return this->arenas_[0];
+    }
+    return this->arenas_[this->node()];
+}
+
+Allocator &Arenas::owner(std::uintptr_t ptr) {
+    auto count = this->count();
+    if (count == 1) {
+        return this->arenas_[0];
+    }
+    return this->arenas_[PageMap::arena(ptr) % count];
+}
+
+bool Arenas::isLocal(std::uintptr_t ptr) {
+    if (this->count() == 1) {
+        return true;
+    }
+
+    return &this->owner(ptr) == &this->local();
+}
+
+Allocator &Arenas::operator[](std::size_t arena) noexcept {
+    return this->arenas_[arena];
+}
+
+void Arenas::freeBatch(std::span<const std::uintptr_t> ptrs) {
+    if (this->count() == 1) {
+        this->arenas_[0].freeBatch(ptrs);
+        return;
+    }
+    // consecutive pointers of the same arena are freed under a single lock
+    while (!ptrs.empty()) {
+        auto &arena = this->owner(ptrs.front());
+        std::size_t count = 1;
+        while (count < ptrs.size() && &this->owner(ptrs[count]) == &arena) {
+            ++count;
+        }
+        arena.freeBatch(ptrs.first(count));
+        ptrs = ptrs.subspan(count);
+    }
+}
+
+void Arenas::freeRemote(std::span<const std::uintptr_t> ptrs) {
+    if (this->count() == 1) {
+        this->arenas_[0].freeRemote(ptrs);
+        return;
+    }
+    for (const auto &ptr : ptrs) {
+        this->owner(ptr).freeRemote(std::span{&ptr, 1});
+    }
+}
+
+FreeStats Arenas::freeStats() {
+    FreeStats stats{0, 0, {}};
+    for (std::size_t i = 0; i < this->count(); ++i) {
+        auto arena = this->arenas_[i].freeStats();
+        stats.retained += arena.retained;
+        stats.freeBytes += arena.freeBytes;
+        for (std::size_t j = 0; j < stats.freeBlocks.size(); ++j) {
+            stats.freeBlocks[j] += arena.freeBlocks[j];
+        }
+    }
+    return stats;
+}
+
+void Arenas::setFakeNodes(std::size_t nodes) {
+    this->fake_.store(true, std::memory_order_relaxed);
+    this->setCount(nodes, false);
+}
+
+} // namespace hse::memory
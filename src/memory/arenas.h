@@ -0,0 +1,105 @@
+#ifndef ARENAS_H
+#define ARENAS_H
+
+#include "allocator.h"
+#include "config/config.h"
+#include "stats.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace hse::memory {
+
+// Arenas holds a separate Allocator for every NUMA node. Allocations
+// of a thread are served by the arena of the node it runs on and memory
+// is always returned to the arena which has mapped it, which is found
+// through PageMap, so that memory freed on one node is not reused
+// by threads on another one. Pages of every arena are bound to its node.
+// The number of nodes is read from the system on the first call unless
+// a fake topology is set, which assigns nodes to threads round-robin
+// without binding pages, so that routing can be tested on a single node.
+// Number of arenas set by HSE_MALLOC_CONF, which differs from the number
+// of nodes, is treated as a fake topology too.
+// With a single node there is a single arena and no extra lookups.
+// It is safe to share Arenas between threads.
+class Arenas {
+  public:
+    // MAX_ARENAS is a maximum number of arenas, nodes beyond it share them
+    static constexpr std::size_t MAX_ARENAS = 8;
+
+    // NODES_ENV is an environment variable which sets fake topology
+    // with given number of nodes
+    static constexpr const char *NODES_ENV = "HSE_MALLOC_NUMA_NODES";
+
+  private:
+    std::array<Allocator, MAX_ARENAS> arenas_;
+
+    // count_ is a number of arenas or zero if it has not been set yet
+    std::atomic<std::size_t> count_;
+
+    // fake_ is true if topology is fake
+    std::atomic<bool> fake_;
+
+    // init sets the number of arenas from the environment or the system,
+    // configures arenas with HSE_MALLOC_CONF and returns the number
+    std::size_t init();
+
+    // configure applies given configuration to given arena
+    static void configure(Allocator &arena, const config::Config &conf);
+
+    // setCount sets given number of arenas, which are bound
+    // to their nodes if bindNodes is true
+    void setCount(std::size_t count, bool bindNodes);
+
+  public:
+    constexpr Arenas() noexcept : arenas_{}, count_(0), fake_(false) {}
+
+    // count returns the number of arenas
+    [[nodiscard]] std::size_t count();
+
+    // single returns if the number of arenas is known to be one
+    [[nodiscard]] bool single() const noexcept {
+        return this->count_.load(std::memory_order_relaxed) == 1;
+    }
+
+    // node returns index of arena of NUMA node of current thread
+    [[nodiscard]] std::size_t node();
+
+    // local returns arena of NUMA node of current thread
+    [[nodiscard]] Allocator &local();
+
+    // owner returns arena which memory pointed by given pointer belongs to
+    [[nodiscard]] Allocator &owner(std::uintptr_t ptr);
+
+    // isLocal returns if memory pointed by given pointer belongs to arena
+    // of NUMA node of current thread
+    [[nodiscard]] bool isLocal(std::uintptr_t ptr);
+
+    // operator[] returns arena with given index.
+    // NOTE: arena should be less than count()
+    [[nodiscard]] Allocator &operator[](std::size_t arena) noexcept;
+
+    // freeBatch deallocates memory pointed by every given pointer
+    // in arenas it belongs to
+    void freeBatch(std::span<const std::uintptr_t> ptrs);
+
+    // freeRemote deallocates slots of slabs pointed by given pointers
+    // without taking locks as Allocator::freeRemote does
+    void freeRemote(std::span<const std::uintptr_t> ptrs);
+
+    // freeStats returns description of memory which is mapped
+    // but not allocated in all arenas
+    [[nodiscard]] FreeStats freeStats();
+
+    // setFakeNodes sets fake topology with given number of nodes,
+    // which are assigned to threads round-robin.
+    // It should be called before the first allocation
+    void setFakeNodes(std::size_t nodes);
+};
+
+} // namespace hse::memory
+
+#endif // ARENAS_H
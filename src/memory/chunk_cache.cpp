@@ -0,0 +1,150 @@
+#include "chunk_cache.h"
+#include "page_source.h"
+#include "stats.h"
+#include "system/system.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace hse::memory {
+
+std::uintptr_t ChunkCache::alloc(std::size_t size, bool *zeroed, std::size_t *mapping) {
+    this->purge(Clock::now());
+
+    // best fit keeps large ranges for large chunks
+    auto best = CAPACITY;
+    for (std::size_t i = 0; i < this->count_; ++i) {
+        if (auto &range = this->ranges_[i];
+            range.size >= size && (range.mapping == 0 || mapping != nullptr)
+            && (best == CAPACITY || range.size < this->ranges_[best].size)) {
+            best = i;
+        }
+    }
+    if (best == CAPACITY) {
+        return 0;
+    }
+
+    auto &range = this->ranges_[best];
+    auto addr = range.addr;
+    if (zeroed != nullptr) {
+        *zeroed = range.zeroed;
+    }
+    if (mapping != nullptr) {
+        *mapping = range.mapping;
+    }
+    if (range.size == size) {
+        this->remove(best);
+    } else {
+        range.addr += size;
+        range.size -= size;
+        this->size_ -= size;
+    }
+    return addr;
+}
+
+void ChunkCache::free(std::uintptr_t addr, std::size_t size, bool zeroed, std::size_t mapping) {
+    auto now = Clock::now();
+    if (size > this->limit_) {
+        ChunkCache::unmap(addr, size);
+        return;
+    }
+
+    // merge with adjacent ranges of the same mapping, so that
+    // a range can be remapped as a whole when it is reused
+    for (std::size_t i = 0; i < this->count_;) {
+        auto &range = this->ranges_[i];
+        if (range.mapping != mapping) {
+            ++i;
+            continue;
+        }
+        if ((range.addr + range.size == addr && (mapping != 0 || !PageSource::mayStartMapping(addr)))
+            || (addr + size == range.addr && (mapping != 0 || !PageSource::mayStartMapping(range.addr)))) {
+            addr = std::min(addr, range.addr);
+            size += range.size;
+            zeroed = zeroed && range.zeroed;
+            this->remove(i);
+            continue;
+        }
+        ++i;
+    }
+
+    if (this->count_ == CAPACITY) {
+        this->evictOldest();
+    }
+    this->ranges_[this->count_++] = Range{addr, size, now, mapping, zeroed};
+    this->size_ += size;
+
+    while (this->size_ > this->limit_) {
+        this->evictOldest();
+    }
+    this->purge(now);
+}
+
+std::size_t ChunkCache::size() const noexcept {
+    return this->size_;
+}
+
+void ChunkCache::setLimit(std::size_t limit) {
+    this->limit_ = limit;
+    while (this->size_ > this->limit_) {
+        this->evictOldest();
+    }
+}
+
+void ChunkCache::setDecay(Clock::duration decay) {
+    this->decay_ = decay;
+    this->purge(Clock::now());
+}
+
+void ChunkCache::purgeAll() {
+    while (this->count_ != 0) {
+        this->evictOldest();
+    }
+}
+
+void ChunkCache::remove(std::size_t i) noexcept {
+    this->size_ -= this->ranges_[i].size;
+    this->ranges_[i] = this->ranges_[--this->count_];
+}
+
+void ChunkCache::evictOldest() {
+    std::size_t oldest = 0;
+    for (std::size_t i = 1; i < this->count_; ++i) {
+        if (this->ranges_[i].released < this->ranges_[oldest].released) {
+            oldest = i;
+        }
+    }
+    auto range = this->ranges_[oldest];
+    this->remove(oldest);
+    ChunkCache::unmap(range.addr, range.size);
+}
+
+void ChunkCache::purge(Clock::time_point now) {
+    for (std::size_t i = 0; i < this->count_;) {
+        auto &range = this->ranges_[i];
+        if (now - range.released < this->decay_) {
+            ++i;
+            continue;
+        }
+
+        if (!range.zeroed && system::purge(range.addr, range.size)) {
+            // keep range mapped for one more decay time
+            range.zeroed = true;
+            range.released = now;
+            continue;
+        }
+
+        auto unmapped = range;
+        this->remove(i);
+        ChunkCache::unmap(unmapped.addr, unmapped.size);
+    }
+}
+
+void ChunkCache::unmap(std::uintptr_t addr, std::size_t size) {
+    system::munmap(addr, size);
+    Stats::sub(Stats::mapped, size);
+    Stats::add(Stats::munmaps, 1);
+}
+
+} // namespace hse::memory
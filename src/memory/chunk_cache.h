@@ -0,0 +1,108 @@
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace hse::memory {
+
+// ChunkCache retains released page ranges instead of unmapping them,
+// so that the next allocation of a chunk can reuse them without a
+// syscall and page faults. It is bounded both by number of ranges and
+// by total size. Ranges which have not been reused during decay time
+// are purged on the next call: their physical pages are released,
+// so they read as zeros, and after one more decay time they are unmapped.
+// Ranges of separate mappings, which pages moved by mremap become,
+// are numbered by their owners and handed out only to those asking
+// for them. Adjacent ranges are merged only if they belong to the same
+// mapping, and ranges of PageSource also only if they can not belong
+// to different reservations.
+// ChunkCache is not thread-safe.
+class ChunkCache {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // CAPACITY is a maximum number of retained ranges
+    static constexpr std::size_t CAPACITY = 64;
+
+    // DEFAULT_LIMIT is a default maximum total size of retained ranges
+    static constexpr std::size_t DEFAULT_LIMIT = 1UL << 25U;
+
+    // DEFAULT_DECAY is a default time for which range is retained
+    static constexpr Clock::duration DEFAULT_DECAY = std::chrono::seconds(10);
+
+  private:
+    // Range is a retained range of pages
+    struct Range {
+        std::uintptr_t addr;
+        std::size_t size;
+        Clock::time_point released;
+
+        // mapping is a number of separate mapping the range belongs to
+        // or zero for reservations of PageSource
+        std::size_t mapping;
+
+        // zeroed is true if the range is known to be filled with zeros
+        bool zeroed;
+    };
+
+    std::array<Range, CAPACITY> ranges_;
+    std::size_t count_;
+
+    // size_ is a total size of retained ranges
+    std::size_t size_;
+
+    std::size_t limit_;
+    Clock::duration decay_;
+
+    // remove removes range with given index from the cache
+    // without unmapping it
+    void remove(std::size_t i) noexcept;
+
+    // unmap returns given range to the system
+    static void unmap(std::uintptr_t addr, std::size_t size);
+
+    // evictOldest unmaps range which has been retained for the longest time
+    void evictOldest();
+
+    // purge purges or unmaps ranges which have been retained
+    // for longer than decay
+    void purge(Clock::time_point now);
+
+  public:
+    constexpr ChunkCache() noexcept
+        : ranges_{}, count_(0), size_(0), limit_(DEFAULT_LIMIT), decay_(DEFAULT_DECAY) {}
+
+    // alloc returns address of retained range of given size
+    // or zero if there is no range large enough.
+    // If zeroed is not nullptr, it is set to whether the range
+    // is known to be filled with zeros. If mapping is not nullptr,
+    // ranges of separate mappings are taken too and it is set to number
+    // of mapping of the range, otherwise only ranges of PageSource are.
+    // NOTE: size should be a multiple of page size
+    [[nodiscard]] std::uintptr_t alloc(std::size_t size, bool *zeroed = nullptr, std::size_t *mapping = nullptr);
+
+    // free retains given range of pages of given mapping, which is known
+    // to be filled with zeros if zeroed is true, or unmaps it if it does
+    // not fit into the cache
+    // NOTE: addr and size should be multiples of page size
+    void free(std::uintptr_t addr, std::size_t size, bool zeroed = false, std::size_t mapping = 0);
+
+    // size returns total size of retained ranges
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    // setLimit sets maximum total size of retained ranges
+    void setLimit(std::size_t limit);
+
+    // setDecay sets time for which range is retained
+    void setDecay(Clock::duration decay);
+
+    // purgeAll unmaps all retained ranges
+    void purgeAll();
+};
+
+} // namespace hse::memory
+
+#endif // CHUNK_CACHE_H
@@ -0,0 +1,256 @@
+#include "free_block_tree.h"
+#include "memory_control_block.h"
+
+#include <cstddef>
+#include <cstring>
+
+namespace hse::memory {
+
+namespace {
+
+// before returns if the first block precedes the second one in the tree
+bool before(const MemoryControlBlock *lhs, const MemoryControlBlock *rhs) noexcept {
+    return lhs->size() < rhs->size() || (lhs->size() == rhs->size() && lhs < rhs);
+}
+
+} // namespace
+
+FreeBlockTree::Node &FreeBlockTree::node(const MemoryControlBlock *mcb) noexcept {
+    return *reinterpret_cast<Node *>(MemoryControlBlock::data(mcb));
+}
+
+bool FreeBlockTree::red(const MemoryControlBlock *mcb) noexcept {
+    return mcb != nullptr && node(mcb).red;
+}
+
+MemoryControlBlock *FreeBlockTree::minimum(MemoryControlBlock *mcb) noexcept {
+    while (node(mcb).left != nullptr) {
+        mcb = node(mcb).left;
+    }
+    return mcb;
+}
+
+bool FreeBlockTree::empty() const noexcept {
+    return this->root_ == nullptr;
+}
+
+void FreeBlockTree::replace(MemoryControlBlock *mcb, MemoryControlBlock *subtree) noexcept {
+    auto *parent = node(mcb).parent;
+    if (parent == nullptr) {
+        this->root_ = subtree;
+    } else if (node(parent).left == mcb) {
+        node(parent).left = subtree;
+    } else {
+        node(parent).right = subtree;
+    }
+    if (subtree != nullptr) {
+        node(subtree).parent = parent;
+    }
+}
+
+void FreeBlockTree::rotateLeft(MemoryControlBlock *mcb) noexcept {
+    auto *right = node(mcb).right;
+    node(mcb).right = node(right).left;
+    if (node(right).left != nullptr) {
+        node(node(right).left).parent = mcb;
+    }
+    this->replace(mcb, right);
+    node(right).left = mcb;
+    node(mcb).parent = right;
+}
+
+void FreeBlockTree::rotateRight(MemoryControlBlock *mcb) noexcept {
+    auto *left = node(mcb).left;
+    node(mcb).left = node(left).right;
+    if (node(left).right != nullptr) {
+        node(node(left).right).parent = mcb;
+    }
+    this->replace(mcb, left);
+    node(left).right = mcb;
+    node(mcb).parent = left;
+}
+
+void FreeBlockTree::insert(MemoryControlBlock *mcb) noexcept {
+    MemoryControlBlock *parent = nullptr;
+    bool left = false;
+    for (auto *current = this->root_; current != nullptr;) {
+        parent = current;
+        left = before(mcb, current);
+        current = left ? node(current).left : node(current).right;
+    }
+
+    node(mcb) = Node{nullptr, nullptr, parent, true};
+    if (parent == nullptr) {
+        this->root_ = mcb;
+    } else if (left) {
+        node(parent).left = mcb;
+    } else {
+        node(parent).right = mcb;
+    }
+    this->fixInsert(mcb);
+}
+
+void FreeBlockTree::fixInsert(MemoryControlBlock *mcb) noexcept {
+    // parent of red block is never the root, which is black
+    while (red(node(mcb).parent)) {
+        auto *parent = node(mcb).parent;
+        auto *grandparent = node(parent).parent;
+        if (parent == node(grandparent).left) {
+            if (auto *uncle = node(grandparent).right; red(uncle)) {
+                node(parent).red = false;
+                node(uncle).red = false;
+                node(grandparent).red = true;
+                mcb = grandparent;
+                continue;
+            }
+            if (mcb == node(parent).right) {
+                this->rotateLeft(parent);
+                parent = mcb;
+            }
+            node(parent).red = false;
+            node(grandparent).red = true;
+            this->rotateRight(grandparent);
+            break;
+        } else {
+            if (auto *uncle = node(grandparent).left; red(uncle)) {
+                node(parent).red = false;
+                node(uncle).red = false;
+                node(grandparent).red = true;
+                mcb = grandparent;
+                continue;
+            }
+            if (mcb == node(parent).left) {
+                this->rotateRight(parent);
+                parent = mcb;
+            }
+            node(parent).red = false;
+            node(grandparent).red = true;
+            this->rotateLeft(grandparent);
+            break;
+        }
+    }
+    node(this->root_).red = false;
+}
+
+void FreeBlockTree::erase(MemoryControlBlock *mcb) noexcept {
+    auto erased = node(mcb);
+    auto removedRed = erased.red;
+    MemoryControlBlock *child = nullptr;
+    MemoryControlBlock *parent = nullptr;
+
+    if (erased.left == nullptr || erased.right == nullptr) {
+        child = erased.left != nullptr ? erased.left : erased.right;
+        parent = erased.parent;
+        this->replace(mcb, child);
+    } else {
+        // successor takes place and color of erased block
+        auto *successor = minimum(erased.right);
+        removedRed = node(successor).red;
+        child = node(successor).right;
+        if (node(successor).parent == mcb) {
+            parent = successor;
+        } else {
+            parent = node(successor).parent;
+            this->replace(successor, child);
+            node(successor).right = erased.right;
+            node(erased.right).parent = successor;
+        }
+        this->replace(mcb, successor);
+        node(successor).left = erased.left;
+        node(erased.left).parent = successor;
+        node(successor).red = erased.red;
+    }
+
+    if (!removedRed) {
+        this->fixErase(child, parent);
+    }
+    if (mcb->zeroed()) {
+        std::memset(&node(mcb), 0, sizeof(Node));
+    }
+}
+
+void FreeBlockTree::fixErase(MemoryControlBlock *mcb, MemoryControlBlock *parent) noexcept {
+    // sibling of a place of removed black block is never a leaf
+    while (mcb != this->root_ && !red(mcb)) {
+        if (mcb == node(parent).left) {
+            auto *sibling = node(parent).right;
+            if (red(sibling)) {
+                node(sibling).red = false;
+                node(parent).red = true;
+                this->rotateLeft(parent);
+                sibling = node(parent).right;
+            }
+            if (!red(node(sibling).left) && !red(node(sibling).right)) {
+                node(sibling).red = true;
+                mcb = parent;
+                parent = node(mcb).parent;
+                continue;
+            }
+            if (!red(node(sibling).right)) {
+                node(node(sibling).left).red = false;
+                node(sibling).red = true;
+                this->rotateRight(sibling);
+                sibling = node(parent).right;
+            }
+            node(sibling).red = node(parent).red;
+            node(parent).red = false;
+            node(node(sibling).right).red = false;
+            this->rotateLeft(parent);
+        } else {
+            auto *sibling = node(parent).left;
+            if (red(sibling)) {
+                node(sibling).red = false;
+                node(parent).red = true;
+                this->rotateRight(parent);
+                sibling = node(parent).left;
+            }
+            if (!red(node(sibling).left) && !red(node(sibling).right)) {
+                node(sibling).red = true;
+                mcb = parent;
+                parent = node(mcb).parent;
+                continue;
+            }
+            if (!red(node(sibling).left)) {
+                node(node(sibling).right).red = false;
+                node(sibling).red = true;
+                this->rotateLeft(sibling);
+                sibling = node(parent).left;
+            }
+            node(sibling).red = node(parent).red;
+            node(parent).red = false;
+            node(node(sibling).left).red = false;
+            this->rotateRight(parent);
+        }
+        mcb = this->root_;
+    }
+    if (mcb != nullptr) {
+        node(mcb).red = false;
+    }
+}
+
+MemoryControlBlock *FreeBlockTree::lowerBound(std::size_t size) const noexcept {
+    MemoryControlBlock *bound = nullptr;
+    for (auto *mcb = this->root_; mcb != nullptr;) {
+        if (mcb->size() >= size) {
+            bound = mcb;
+            mcb = node(mcb).left;
+        } else {
+            mcb = node(mcb).right;
+        }
+    }
+    return bound;
+}
+
+MemoryControlBlock *FreeBlockTree::next(const MemoryControlBlock *mcb) noexcept {
+    if (node(mcb).right != nullptr) {
+        return minimum(node(mcb).right);
+    }
+    auto *parent = node(mcb).parent;
+    while (parent != nullptr && mcb == node(parent).right) {
+        mcb = parent;
+        parent = node(mcb).parent;
+    }
+    return parent;
+}
+
+} // namespace hse::memory
@@ -0,0 +1,95 @@
+#ifndef FREE_BLOCK_TREE_H
+#define FREE_BLOCK_TREE_H
+
+#include "memory_control_block.h"
+
+#include <cstddef>
+
+namespace hse::memory {
+
+// FreeBlockTree is a red-black tree of free blocks ordered by size
+// and then by address, so that the smallest block which fits a size
+// is found in logarithmic time.
+// Nodes are stored in data of blocks right after their headers,
+// so blocks should be large enough to hold a node.
+// Data of blocks, which is known to be zero, is zeroed back
+// when they are erased from the tree.
+// NOTE: size of a block should not be changed while it is in the tree
+class FreeBlockTree {
+  public:
+    // MIN_SIZE is a minimum size of block in the tree
+    static constexpr std::size_t MIN_SIZE = 4 * sizeof(MemoryControlBlock *);
+
+  private:
+    struct Node {
+        MemoryControlBlock *left;
+        MemoryControlBlock *right;
+        MemoryControlBlock *parent;
+        bool red;
+    };
+
+    static_assert(sizeof(Node) <= MIN_SIZE);
+
+    MemoryControlBlock *root_;
+
+    // node returns node of given block
+    [[nodiscard]] static Node &node(const MemoryControlBlock *mcb) noexcept;
+
+    // red returns if given block is red, leaves are black
+    [[nodiscard]] static bool red(const MemoryControlBlock *mcb) noexcept;
+
+    // minimum returns the smallest block in subtree of given one
+    [[nodiscard]] static MemoryControlBlock *minimum(MemoryControlBlock *mcb) noexcept;
+
+    // replace puts given subtree in place of given block for its parent
+    void replace(MemoryControlBlock *mcb, MemoryControlBlock *subtree) noexcept;
+
+    // rotateLeft moves right child of given block in its place
+    void rotateLeft(MemoryControlBlock *mcb) noexcept;
+
+    // rotateRight moves left child of given block in its place
+    void rotateRight(MemoryControlBlock *mcb) noexcept;
+
+    // fixInsert restores balance after insertion of given block
+    void fixInsert(MemoryControlBlock *mcb) noexcept;
+
+    // fixErase restores balance after removal of a black block
+    // from place of given one, which can be a leaf, with given parent
+    void fixErase(MemoryControlBlock *mcb, MemoryControlBlock *parent) noexcept;
+
+  public:
+    constexpr FreeBlockTree() noexcept : root_(nullptr) {}
+
+    // empty returns if there are no blocks in the tree
+    [[nodiscard]] bool empty() const noexcept;
+
+    // insert puts given block to the tree.
+    // NOTE: block should not be smaller than MIN_SIZE
+    void insert(MemoryControlBlock *mcb) noexcept;
+
+    // erase removes given block from the tree
+    void erase(MemoryControlBlock *mcb) noexcept;
+
+    // lowerBound returns the smallest block which is not smaller
+    // than given size or nullptr if there is no such block
+    [[nodiscard]] MemoryControlBlock *lowerBound(std::size_t size) const noexcept;
+
+    // next returns block which follows given one in the tree
+    // or nullptr if it is the last
+    [[nodiscard]] static MemoryControlBlock *next(const MemoryControlBlock *mcb) noexcept;
+
+    // forEach calls given function for every block in the tree
+    template<typename F>
+    void forEach(F f) const {
+        if (this->root_ == nullptr) {
+            return;
+        }
+        for (auto *mcb = minimum(this->root_); mcb != nullptr; mcb = next(mcb)) {
+            f(mcb);
+        }
+    }
+};
+
+} // namespace hse::memory
+
+#endif // FREE_BLOCK_TREE_H
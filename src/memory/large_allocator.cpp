@@ -0,0 +1,112 @@
+#include "large_allocator.h"
+#include "math/math.h"
+#include "memory_control_block.h"
+#include "page_map.h"
+#include "span.h"
+#include "stats.h"
+#include "system/system.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace hse::memory {
+
+std::uintptr_t LargeAllocator::dataPage(std::uintptr_t ptr) noexcept {
+    return math::roundDown(ptr, 1UL << PageMap::PAGE_SHIFT);
+}
+
+std::uintptr_t LargeAllocator::alloc(std::size_t size, std::size_t alignment, bool *zeroed) {
+    alignment = std::max(alignment, MemoryControlBlock::ALIGNMENT);
+    // data can not be placed at the beginning of pages
+    // since it is occupied by Span
+    auto totalSize = math::roundUp(
+        alignment > system::PAGE_SIZE()
+            ? sizeof(Span) + alignment + size
+            : math::roundUp(sizeof(Span), alignment) + size,
+        system::PAGE_SIZE());
+
+    bool isZeroed = false;
+    std::size_t mapping = 0;
+    auto addr = this->chunks_->alloc(totalSize, &isZeroed, &mapping);
+    if (addr == 0) {
+        addr = this->pages_->alloc(totalSize);
+        isZeroed = true;
+    }
+
+    auto *span = Span::createLarge(addr, totalSize, mapping);
+    auto ptr = math::roundUp(addr + sizeof(Span), alignment);
+    try {
+        PageMap::set(LargeAllocator::dataPage(ptr), 1UL << PageMap::PAGE_SHIFT, span);
+    } catch (...) {
+        this->chunks_->free(addr, totalSize, false, mapping);
+        throw;
+    }
+
+    if (zeroed != nullptr) {
+        *zeroed = isZeroed;
+    }
+    Stats::add(Stats::allocated, LargeAllocator::usableSize(span, ptr));
+    return ptr;
+}
+
+std::uintptr_t LargeAllocator::realloc(Span *span, std::uintptr_t ptr, std::size_t size) {
+    auto offset = ptr - span->addr();
+    auto oldSize = span->size();
+    auto newSize = math::roundUp(offset + size, system::PAGE_SIZE());
+    if (newSize == oldSize) {
+        return ptr;
+    }
+
+    auto mapping = span->mapping();
+    std::uintptr_t addr = 0;
+    try {
+        addr = system::mremap(span->addr(), oldSize, newSize);
+    } catch (...) {
+        addr = 0;
+    }
+    if (addr == 0) {
+        return 0;
+    }
+
+    if (newSize > oldSize) {
+        Stats::add(Stats::mapped, newSize - oldSize);
+        Stats::add(Stats::allocated, newSize - oldSize);
+    } else {
+        Stats::sub(Stats::mapped, oldSize - newSize);
+        Stats::sub(Stats::allocated, oldSize - newSize);
+    }
+
+    // Span has been moved together with pages,
+    // so only its size and the page of data are updated.
+    // Moved pages are a new mapping at address chosen by the system,
+    // which can be next to any other one
+    auto oldPtr = ptr;
+    ptr = addr + offset;
+    if (ptr != oldPtr) {
+        mapping = ++this->mappings_;
+    }
+    span = Span::createLarge(addr, newSize, mapping);
+    if (ptr != oldPtr) {
+        PageMap::set(LargeAllocator::dataPage(oldPtr), 1UL << PageMap::PAGE_SHIFT, nullptr);
+        if (this->pages_->tagged()) {
+            PageMap::setArena(addr, newSize, this->pages_->arena());
+        }
+        PageMap::set(LargeAllocator::dataPage(ptr), 1UL << PageMap::PAGE_SHIFT, span);
+    } else if (newSize > oldSize && this->pages_->tagged()) {
+        PageMap::setArena(addr + oldSize, newSize - oldSize, this->pages_->arena());
+    }
+    return ptr;
+}
+
+void LargeAllocator::free(Span *span, std::uintptr_t ptr) {
+    PageMap::set(LargeAllocator::dataPage(ptr), 1UL << PageMap::PAGE_SHIFT, nullptr);
+    Stats::sub(Stats::allocated, LargeAllocator::usableSize(span, ptr));
+    this->chunks_->free(span->addr(), span->size(), false, span->mapping());
+}
+
+std::size_t LargeAllocator::usableSize(const Span *span, std::uintptr_t ptr) noexcept {
+    return span->addr() + span->size() - ptr;
+}
+
+} // namespace hse::memory
@@ -0,0 +1,66 @@
+#ifndef LARGE_ALLOCATOR_H
+#define LARGE_ALLOCATOR_H
+
+#include "chunk_cache.h"
+#include "page_source.h"
+#include "span.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hse::memory {
+
+// LargeAllocator maps every large allocation as a separate run of pages
+// with a Span at its beginning, so that large allocations never enter
+// chain of free blocks and are released at once.
+// Only the page holding data pointer is registered in PageMap.
+// LargeAllocator is not thread-safe.
+class LargeAllocator {
+  public:
+    // DEFAULT_THRESHOLD is a default size starting from which
+    // allocations are considered large
+    static constexpr std::size_t DEFAULT_THRESHOLD = 1UL << 18U;
+
+  private:
+    // chunks_ is a source of retained pages for large allocations
+    ChunkCache *chunks_;
+
+    // pages_ is a source of fresh pages for large allocations
+    PageSource *pages_;
+
+    // mappings_ is a number of separate mappings pages have been moved to,
+    // which numbers them in chunks_
+    std::size_t mappings_;
+
+    // dataPage returns the beginning of PageMap page holding given pointer
+    static std::uintptr_t dataPage(std::uintptr_t ptr) noexcept;
+
+  public:
+    constexpr LargeAllocator(ChunkCache &chunks, PageSource &pages) noexcept
+        : chunks_(&chunks), pages_(&pages), mappings_(0) {}
+
+    // alloc maps memory of given size with given alignment.
+    // If zeroed is not nullptr, it is set to whether the memory
+    // is known to be filled with zeros
+    [[nodiscard]] std::uintptr_t alloc(std::size_t size, std::size_t alignment, bool *zeroed = nullptr);
+
+    // realloc resizes large allocation pointed by ptr, which belongs to
+    // given span, growing it in place or moving its pages to another
+    // address without copying.
+    // It returns pointer to resized allocation or zero if remapping
+    // is not possible, in which case the allocation is left untouched.
+    // NOTE: it throws if moved pages can not be registered in PageMap,
+    // which happens only if PageMap itself runs out of memory
+    [[nodiscard]] std::uintptr_t realloc(Span *span, std::uintptr_t ptr, std::size_t size);
+
+    // free releases large allocation pointed by ptr, which belongs to given span
+    void free(Span *span, std::uintptr_t ptr);
+
+    // usableSize returns the size of large allocation pointed by ptr,
+    // which belongs to given span
+    [[nodiscard]] static std::size_t usableSize(const Span *span, std::uintptr_t ptr) noexcept;
+};
+
+} // namespace hse::memory
+
+#endif // LARGE_ALLOCATOR_H
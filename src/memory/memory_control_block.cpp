@@ -16,13 +16,15 @@ std::uintptr_t MemoryControlBlock::data(const MemoryControlBlock *mcb) noexcept
 }
 
 std::size_t MemoryControlBlock::size() const noexcept {
-    return math::roundDown(this->size_, 2);
+    return math::roundDown(this->size_, MemoryControlBlock::ALIGNMENT);
 }
 
 bool MemoryControlBlock::empty() const noexcept { return this->size() == 0; }
 
 void MemoryControlBlock::setSize(std::size_t size) noexcept {
-    this->size_ = math::roundUp(size, 2) | static_cast<std::size_t>(this->busy());
+    // keep flags stored in lower bits
+    this->size_ = math::roundUp(size, MemoryControlBlock::ALIGNMENT)
+        | (this->size_ & (MemoryControlBlock::ALIGNMENT - 1));
 }
 
 void MemoryControlBlock::grow(std::size_t size) noexcept {
@@ -53,6 +55,14 @@ void MemoryControlBlock::markFree() noexcept {
     this->size_ = math::clearNthBit(this->size_, 0);
 }
 
+bool MemoryControlBlock::zeroed() const noexcept {
+    return math::nthBit(this->size_, 1);
+}
+
+void MemoryControlBlock::setZeroed(bool zeroed) noexcept {
+    this->size_ = zeroed ? math::setNthBit(this->size_, 1) : math::clearNthBit(this->size_, 1);
+}
+
 MemoryControlBlock *MemoryControlBlock::prev() const noexcept {
     return this->prev_;
 }
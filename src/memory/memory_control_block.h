@@ -9,9 +9,15 @@ namespace hse::memory {
 // MemoryControlBlock is placed right before
 // every allocated block of memory and describes following block
 class MemoryControlBlock {
+  public:
+    // ALIGNMENT is an alignment of every block and its data.
+    // Size of every block is a multiple of it
+    static constexpr std::size_t ALIGNMENT = alignof(std::max_align_t);
+
   private:
-    // size_ holds availability of block in first least bit
-    // and size of block in rest. Thus, size of block is always 2-aligned
+    // size_ holds availability of block in first least bit,
+    // whether its data is known to be zero in second least bit
+    // and size of block in rest. Thus, size of block is always ALIGNMENT-aligned
     std::size_t size_;
 
     // prev_ holds pointer to previous block in same chunk.
@@ -44,11 +50,11 @@ class MemoryControlBlock {
     [[nodiscard]] bool empty() const noexcept;
 
     // setSize sets size of block.
-    // NOTE: size should be multiple of 2
+    // NOTE: size should be multiple of ALIGNMENT
     void setSize(std::size_t) noexcept;
 
     // grow increases size of block by given value
-    // NOTE: size should be multiple of 2
+    // NOTE: size should be multiple of ALIGNMENT
     void grow(std::size_t) noexcept;
 
     // fits returns if there is enough space in block for given size
@@ -72,6 +78,13 @@ class MemoryControlBlock {
     // markFree marks block as free
     void markFree() noexcept;
 
+    // zeroed returns if data of the block is known to be filled with zeros,
+    // e.g. it has not been touched since it was mapped
+    [[nodiscard]] bool zeroed() const noexcept;
+
+    // setZeroed sets whether data of the block is known to be filled with zeros
+    void setZeroed(bool) noexcept;
+
     // prev returns a pointer to previous block in same chunk.
     // If it is nullptr then it is the first block in chunk.
     [[nodiscard]] MemoryControlBlock *prev() const noexcept;
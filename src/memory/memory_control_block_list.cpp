@@ -1,37 +1,118 @@
 #include "memory_control_block_list.h"
+#include "free_block_tree.h"
+#include "math/math.h"
 #include "memory_control_block.h"
 
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
 namespace hse::memory {
 
-FreeMemoryControlBlockList::FreeMemoryControlBlockList() noexcept :
-    first_(nullptr) {}
+static_assert(FreeMemoryControlBlockList::BINS % std::numeric_limits<std::uint64_t>::digits == 0);
+
+// blocks of bins replaced by the tree are larger than blocks of small bins,
+// which are large enough to hold its nodes
+static_assert(FreeMemoryControlBlockList::TREE_SIZE_MIN > FreeMemoryControlBlockList::SMALL_BIN_SIZE_MAX);
+static_assert(FreeMemoryControlBlockList::SMALL_BIN_SIZE_MAX >= FreeBlockTree::MIN_SIZE);
+
+std::size_t FreeMemoryControlBlockList::nextNonEmpty(std::size_t bin) const noexcept {
+    auto word = bin / BITMAP_WORD_BITS;
+    if (word >= this->nonEmpty_.size()) {
+        return BINS;
+    }
 
-MemoryControlBlock *FreeMemoryControlBlockList::first() const noexcept {
-    return this->first_;
+    // ignore bins before given one
+    auto bits = this->nonEmpty_[word] & (~std::uint64_t{0} << (bin % BITMAP_WORD_BITS));
+    while (bits == 0) {
+        if (++word == this->nonEmpty_.size()) {
+            return BINS;
+        }
+        bits = this->nonEmpty_[word];
+    }
+    return word * BITMAP_WORD_BITS + std::countr_zero(bits);
 }
 
-void FreeMemoryControlBlockList::setFirst(MemoryControlBlock *mcb) noexcept {
-    if ((this->first_ = mcb) == nullptr) {
+bool FreeMemoryControlBlockList::empty() const noexcept {
+    return this->nextNonEmpty(0) == BINS && this->tree_.empty();
+}
+
+void FreeMemoryControlBlockList::insert(MemoryControlBlock *mcb) noexcept {
+    mcb->markFree();
+    auto bin = binIndex(mcb->size());
+    if (inTree(bin)) {
+        MemoryControlBlock::setPrevFree(mcb, nullptr);
+        MemoryControlBlock::setNextFree(mcb, nullptr);
+        this->tree_.insert(mcb);
         return;
     }
-    MemoryControlBlock::setPrevFree(mcb, nullptr);
+    switch (this->placement_) {
+    case Placement::LIFO:
+        this->link(bin, nullptr, mcb, this->bins_[bin]);
+        break;
+    case Placement::ADDRESS:
+        this->insertOrdered(bin, mcb, mcbByAddress);
+        break;
+    case Placement::BEST:
+        this->insertOrdered(bin, mcb, mcbBySize);
+        break;
+    }
 }
 
-void FreeMemoryControlBlockList::prepend(MemoryControlBlock *mcb) noexcept {
-    mcb->markFree();
-    MemoryControlBlock::setNextFree(mcb, this->first());
-    this->setFirst(mcb);
+void FreeMemoryControlBlockList::link(std::size_t bin, MemoryControlBlock *prev,
+    MemoryControlBlock *mcb, MemoryControlBlock *next) noexcept {
+    MemoryControlBlock::setPrevFree(mcb, prev);
+    MemoryControlBlock::setNextFree(mcb, next);
+    if (prev == nullptr) {
+        this->bins_[bin] = mcb;
+    }
+
+    auto &word = this->nonEmpty_[bin / BITMAP_WORD_BITS];
+    word = math::setNthBit(word, bin % BITMAP_WORD_BITS);
+}
+
+Placement FreeMemoryControlBlockList::placement() const noexcept {
+    return this->placement_;
+}
+
+void FreeMemoryControlBlockList::setPlacement(Placement placement) noexcept {
+    this->placement_ = placement;
+    for (std::size_t bin = 0; bin < BINS; ++bin) {
+        auto *mcb = this->bins_[bin];
+        this->bins_[bin] = nullptr;
+        auto &word = this->nonEmpty_[bin / BITMAP_WORD_BITS];
+        word = math::clearNthBit(word, bin % BITMAP_WORD_BITS);
+
+        while (mcb != nullptr) {
+            auto *next = mcb->nextFree();
+            this->insert(mcb);
+            mcb = next;
+        }
+    }
 }
 
 void FreeMemoryControlBlockList::pop(MemoryControlBlock *mcb) noexcept {
-    if (this->first() == mcb) {
-        this->setFirst(mcb->nextFree());
+    if (inTree(binIndex(mcb->size()))) {
+        this->tree_.erase(mcb);
+        return;
     }
 
-    if (auto *prev = mcb->prevFree(); prev != nullptr) {
-        MemoryControlBlock::setNextFree(prev, mcb->nextFree());
-    } else if (auto *next = mcb->nextFree(); next != nullptr) {
-        MemoryControlBlock::setPrevFree(next, prev);
+    auto *prev = mcb->prevFree();
+    auto *next = mcb->nextFree();
+
+    if (prev != nullptr) {
+        MemoryControlBlock::setNextFree(prev, next);
+    } else {
+        // block is the first in its bin
+        auto bin = binIndex(mcb->size());
+        this->bins_[bin] = next;
+        if (next != nullptr) {
+            MemoryControlBlock::setPrevFree(next, nullptr);
+        } else {
+            auto &word = this->nonEmpty_[bin / BITMAP_WORD_BITS];
+            word = math::clearNthBit(word, bin % BITMAP_WORD_BITS);
+        }
     }
     MemoryControlBlock::setPrevFree(mcb, nullptr);
     MemoryControlBlock::setNextFree(mcb, nullptr);
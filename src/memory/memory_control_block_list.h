@@ -1,9 +1,12 @@
 #ifndef MEMORY_CONTROL_BLOCK_LIST_H
 #define MEMORY_CONTROL_BLOCK_LIST_H
 
+#include "free_block_tree.h"
 #include "memory_control_block.h"
 #include "math/math.h"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
@@ -39,33 +42,126 @@ MCBPredicate auto operator||(P1 p1, P2 p2) {
 // template<typename T>
 // concept MCBMetric = std::is_nothrow_invocable_r_v<std::size_t, T, const MemoryControlBlock*>;
 
+// MCBOrder returns if the first block should be placed
+// before the second one in a bin
+template<typename T>
+concept MCBOrder = std::is_nothrow_invocable_r_v<bool, T, const MemoryControlBlock*, const MemoryControlBlock*>;
+
+// mcbByAddress orders blocks by address
+constexpr MCBOrder auto mcbByAddress = [](const MemoryControlBlock *lhs, const MemoryControlBlock *rhs) noexcept {
+  return lhs < rhs;
+};
+
+// mcbBySize orders blocks by size and then by address
+constexpr MCBOrder auto mcbBySize = [](const MemoryControlBlock *lhs, const MemoryControlBlock *rhs) noexcept {
+  return lhs->size() < rhs->size() || (lhs->size() == rhs->size() && lhs < rhs);
+};
+
+// Placement is a policy of choosing a free block for allocation,
+// which is set by order of blocks in bins, since the first fitting
+// block of the first bin with one is taken
+enum class Placement : std::uint8_t {
+  // LIFO takes the most recently freed block
+  LIFO,
+
+  // ADDRESS takes the block with the lowest address
+  ADDRESS,
+
+  // BEST takes the smallest block, so that large blocks are not split
+  // by small allocations
+  BEST,
+};
+
+// FreeMemoryControlBlockList is a chain of free blocks segregated
+// into bins by size: there is a bin for every size up to SMALL_BIN_SIZE_MAX
+// and BINS_PER_DOUBLING bins for every doubling of size after it.
+// Bitmap of non-empty bins allows to skip empty ones at once.
+// Blocks within a bin are ordered according to placement policy.
+// Ordered insertion walks the bin, so it is linear in its length.
+// Bins of blocks from TREE_SIZE_MIN to TREE_SIZE_MAX are replaced by
+// a FreeBlockTree, which always places them best-fit in logarithmic time,
+// since size bins are too coarse for them.
+// NOTE: size of a block should not be changed while it is in the chain
 class FreeMemoryControlBlockList {
+  public:
+    // SMALL_BINS is a number of bins holding blocks of exactly one size
+    static constexpr std::size_t SMALL_BINS = 64;
+
+    // SMALL_BIN_SIZE_MAX is a maximum size of block in small bins
+    static constexpr std::size_t SMALL_BIN_SIZE_MAX = SMALL_BINS * MemoryControlBlock::ALIGNMENT;
+
+    // BINS_PER_DOUBLING is a number of bins for every doubling of size
+    // after SMALL_BIN_SIZE_MAX
+    static constexpr std::size_t BINS_PER_DOUBLING = 4;
+
+    // BINS is a total number of bins. The last one holds all blocks
+    // which are too large for the others
+    static constexpr std::size_t BINS = SMALL_BINS + 32 * BINS_PER_DOUBLING;
+
+    // TREE_SIZE_MIN is a size of block in the first bin replaced by the tree
+    static constexpr std::size_t TREE_SIZE_MIN = 4096;
+
+    // TREE_SIZE_MAX is a size of block in the last bin replaced by the tree
+    static constexpr std::size_t TREE_SIZE_MAX = 1 << 20;
+
+    // TREE_WALK_MAX is a number of blocks of the tree, which are checked
+    // by find before it skips to blocks known to satisfy its predicate
+    static constexpr std::size_t TREE_WALK_MAX = 8;
+
   private:
-    MemoryControlBlock *first_;
+    static constexpr std::size_t BITMAP_WORD_BITS = std::numeric_limits<std::uint64_t>::digits;
 
-  public:
-    FreeMemoryControlBlockList() noexcept;
+    std::array<MemoryControlBlock *, BINS> bins_;
 
-    // first returns pointer to first block in chain of free blocks.
-    // If it is nullptr then the chain is empty
-    [[nodiscard]] MemoryControlBlock* first() const noexcept;
+    // nonEmpty_ holds a bit for every bin, which is set if bin is not empty
+    std::array<std::uint64_t, BINS / BITMAP_WORD_BITS> nonEmpty_;
 
-    // setFirst sets first free block to given one.
-    void setFirst(MemoryControlBlock *) noexcept;
+    FreeBlockTree tree_;
 
-    // prepend prepends given block to start of chain of free blocks
-    void prepend(MemoryControlBlock *) noexcept;
+    Placement placement_;
 
-    // popFree extracts given block from chain of free blocks
-    // and moves firstFree if needed
-    void pop(MemoryControlBlock *) noexcept;
+    // binIndex returns index of bin which holds blocks of given size
+    static constexpr std::size_t binIndex(std::size_t size) noexcept {
+      if (size <= SMALL_BIN_SIZE_MAX) {
+        return size == 0 ? 0 : (size - 1) / MemoryControlBlock::ALIGNMENT;
+      }
+      auto log = math::log2(size - 1);
+      return std::min(SMALL_BINS
+          + (log - math::log2(SMALL_BIN_SIZE_MAX)) * BINS_PER_DOUBLING
+          + (((size - 1) >> (log - 2)) & (BINS_PER_DOUBLING - 1)),
+          BINS - 1);
+    }
 
-    // findPred returns first block in chain of free blocks
-    // for which pred returns true
+    // inTree returns if blocks of given bin are held by the tree
+    static constexpr bool inTree(std::size_t bin) noexcept {
+      return bin >= binIndex(TREE_SIZE_MIN) && bin <= binIndex(TREE_SIZE_MAX);
+    }
+
+    // nextNonEmpty returns index of the first non-empty bin
+    // starting from given one or BINS if there is no such bin
+    [[nodiscard]] std::size_t nextNonEmpty(std::size_t bin) const noexcept;
+
+    // insertOrdered inserts given block to given bin before the first
+    // block, which it should be placed before according to given order
+    template<MCBOrder O>
+    void insertOrdered(std::size_t bin, MemoryControlBlock *mcb, O before) noexcept {
+      MemoryControlBlock *prev = nullptr;
+      auto *next = this->bins_[bin];
+      while (next != nullptr && !before(mcb, next)) {
+        prev = next;
+        next = next->nextFree();
+      }
+      this->link(bin, prev, mcb, next);
+    }
+
+    // link links given block between given neighbors in given bin
+    void link(std::size_t bin, MemoryControlBlock *prev, MemoryControlBlock *mcb, MemoryControlBlock *next) noexcept;
+
+    // findInBin returns first block in given bin for which pred returns true
     // It returns nullptr if there is no such block
     template<MCBPredicate P>
-    MemoryControlBlock* findPred(P pred) const noexcept {
-      for (auto *mcb = this->first(); mcb != nullptr; mcb = mcb->nextFree()) {
+    MemoryControlBlock* findInBin(std::size_t bin, P pred) const noexcept {
+      for (auto *mcb = this->bins_[bin]; mcb != nullptr; mcb = mcb->nextFree()) {
         if (pred(mcb)) {
           return mcb;
         }
@@ -73,6 +169,99 @@ class FreeMemoryControlBlockList {
       return nullptr;
     }
 
+    // findInBins returns first block in non-empty bins from first
+    // to last inclusive for which pred returns true.
+    // It returns nullptr if there is no such block
+    template<MCBPredicate P>
+    MemoryControlBlock* findInBins(std::size_t first, std::size_t last, P pred) const noexcept {
+      for (auto bin = this->nextNonEmpty(first); bin <= last; bin = this->nextNonEmpty(bin + 1)) {
+        if (auto *mcb = this->findInBin(bin, pred); mcb != nullptr) {
+          return mcb;
+        }
+      }
+      return nullptr;
+    }
+
+    // findInTree returns the smallest block of the tree, which is not
+    // smaller than given size, for which pred returns true.
+    // If TREE_WALK_MAX blocks do not satisfy pred, it skips to blocks
+    // which are not smaller than fitSize.
+    // It returns nullptr if there is no such block
+    template<MCBPredicate P>
+    MemoryControlBlock* findInTree(std::size_t size, P pred, std::size_t fitSize) const noexcept {
+      auto *mcb = this->tree_.lowerBound(size);
+      for (std::size_t walked = 1; mcb != nullptr && !pred(mcb); ++walked) {
+        mcb = walked == TREE_WALK_MAX && fitSize > mcb->size()
+          ? this->tree_.lowerBound(fitSize)
+          : FreeBlockTree::next(mcb);
+      }
+      return mcb;
+    }
+
+  public:
+    constexpr FreeMemoryControlBlockList() noexcept : bins_{}, nonEmpty_{}, tree_{}, placement_(Placement::LIFO) {}
+
+    // empty returns if there are no blocks in the chain
+    [[nodiscard]] bool empty() const noexcept;
+
+    // insert puts given block to its bin according to placement policy
+    void insert(MemoryControlBlock *) noexcept;
+
+    // pop extracts given block from chain of free blocks
+    void pop(MemoryControlBlock *) noexcept;
+
+    // find returns first block in chain of free blocks, which can be
+    // not smaller than given size, for which pred returns true.
+    // Only bins with large enough blocks are searched.
+    // Every block, which is not smaller than fitSize, should satisfy pred,
+    // so that the tree is searched in logarithmic time. It is ignored
+    // if it does not exceed size.
+    // It returns nullptr if there is no such block
+    template<MCBPredicate P>
+    MemoryControlBlock* find(std::size_t size, P pred, std::size_t fitSize = 0) const noexcept {
+      constexpr auto treeFirst = binIndex(TREE_SIZE_MIN);
+      constexpr auto treeLast = binIndex(TREE_SIZE_MAX);
+
+      auto bin = binIndex(size);
+      if (bin < treeFirst) {
+        if (auto *mcb = this->findInBins(bin, treeFirst - 1, pred); mcb != nullptr) {
+          return mcb;
+        }
+      }
+      if (bin <= treeLast) {
+        if (auto *mcb = this->findInTree(size, pred, fitSize); mcb != nullptr) {
+          return mcb;
+        }
+      }
+      return this->findInBins(std::max(bin, treeLast + 1), BINS - 1, pred);
+    }
+
+    // forEach calls given function for every block in chain of free blocks
+    template<typename F>
+    void forEach(F f) const {
+      for (auto bin = this->nextNonEmpty(0); bin < BINS; bin = this->nextNonEmpty(bin + 1)) {
+        for (auto *mcb = this->bins_[bin]; mcb != nullptr; mcb = mcb->nextFree()) {
+          f(mcb);
+        }
+      }
+      this->tree_.forEach(f);
+    }
+
+    // placement returns placement policy
+    [[nodiscard]] Placement placement() const noexcept;
+
+    // setPlacement sets placement policy and reorders blocks
+    // which are already in the chain
+    void setPlacement(Placement placement) noexcept;
+
+    // findPred returns first block in chain of free blocks
+    // for which pred returns true
+    // It returns nullptr if there is no such block
+    template<MCBPredicate P>
+    MemoryControlBlock* findPred(P pred) const noexcept {
+      return this->find(0, pred);
+    }
+
 }; // MemoryControlBlockList
 
 } // namespace hse::memory
@@ -0,0 +1,89 @@
+#include "page_map.h"
+#include "system/system.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace hse::memory {
+
+std::array<std::atomic<PageMap::Node *>, PageMap::LEVEL_SIZE> PageMap::root{};
+
+namespace {
+
+// install returns node stored in given slot, allocating it first if needed
+template<typename T>
+T *install(std::atomic<T *> &slot) {
+    if (auto *node = slot.load(std::memory_order_acquire); node != nullptr) {
+        return node;
+    }
+
+    auto *node = new (reinterpret_cast<void *>(system::mmap(sizeof(T)))) T{};
+    T *expected = nullptr;
+    if (!slot.compare_exchange_strong(expected, node, std::memory_order_acq_rel)) {
+        // another thread has installed the node first
+        system::munmap(reinterpret_cast<std::uintptr_t>(node), sizeof(T));
+        return expected;
+    }
+    return node;
+}
+
+} // namespace
+
+PageMap::Leaf *PageMap::leaf(std::uintptr_t page, bool create) {
+    auto &rootSlot = PageMap::root[(page >> (2 * LEVEL_BITS)) % LEVEL_SIZE];
+    auto *node = create ? install(rootSlot) : rootSlot.load(std::memory_order_acquire);
+    if (node == nullptr) {
+        return nullptr;
+    }
+
+    auto &nodeSlot = (*node)[(page >> LEVEL_BITS) % LEVEL_SIZE];
+    return create ? install(nodeSlot) : nodeSlot.load(std::memory_order_acquire);
+}
+
+std::uintptr_t PageMap::entry(std::uintptr_t addr) noexcept {
+    auto page = addr >> PAGE_SHIFT;
+    if (page >> (3 * LEVEL_BITS) != 0) {
+        // address is out of the map
+        return 0;
+    }
+
+    auto *leaf = PageMap::leaf(page, false);
+    if (leaf == nullptr) {
+        return 0;
+    }
+    return (*leaf)[page % LEVEL_SIZE].load(std::memory_order_acquire);
+}
+
+Span *PageMap::get(std::uintptr_t addr) noexcept {
+    return reinterpret_cast<Span *>(PageMap::entry(addr) & ~ARENA_MASK);
+}
+
+std::size_t PageMap::arena(std::uintptr_t addr) noexcept {
+    return PageMap::entry(addr) & ARENA_MASK;
+}
+
+void PageMap::set(std::uintptr_t addr, std::size_t size, Span *span) {
+    for (auto page = addr >> PAGE_SHIFT; page < (addr + size) >> PAGE_SHIFT; ++page) {
+        if (page >> (3 * LEVEL_BITS) != 0) {
+            throw std::bad_alloc{};
+        }
+        auto &entry = (*PageMap::leaf(page, true))[page % LEVEL_SIZE];
+        // updates are serialized, so arena can not be changed meanwhile
+        auto arena = entry.load(std::memory_order_relaxed) & ARENA_MASK;
+        entry.store(reinterpret_cast<std::uintptr_t>(span) | arena, std::memory_order_release);
+    }
+}
+
+void PageMap::setArena(std::uintptr_t addr, std::size_t size, std::size_t arena) {
+    for (auto page = addr >> PAGE_SHIFT; page < (addr + size) >> PAGE_SHIFT; ++page) {
+        if (page >> (3 * LEVEL_BITS) != 0) {
+            throw std::bad_alloc{};
+        }
+        (*PageMap::leaf(page, true))[page % LEVEL_SIZE].store(arena, std::memory_order_release);
+    }
+}
+
+} // namespace hse::memory
@@ -0,0 +1,71 @@
+#ifndef PAGE_MAP_H
+#define PAGE_MAP_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace hse::memory {
+
+class Span;
+
+// PageMap maps every page of address space to the Span it belongs to
+// and to the arena which has mapped it.
+// It is a three-level radix tree over page numbers, which nodes are
+// allocated on demand and never freed. Spans are aligned to pages,
+// so an index of arena is kept in low bits of the pointer to Span.
+// Lookups are lock-free, so that any thread can find Span of a pointer.
+// Updates of the same pages should be serialized by the caller.
+class PageMap {
+  public:
+    // PAGE_SHIFT is a binary logarithm of granularity of the map.
+    // It does not depend on the system page size, which is a multiple of it
+    static constexpr std::size_t PAGE_SHIFT = 12;
+
+    // MAX_ARENAS is a maximum number of arenas which can be recorded
+    static constexpr std::size_t MAX_ARENAS = 1UL << PAGE_SHIFT;
+
+  private:
+    static constexpr std::size_t ADDRESS_BITS = 48;
+    static constexpr std::size_t LEVEL_BITS = (ADDRESS_BITS - PAGE_SHIFT) / 3;
+    static constexpr std::size_t LEVEL_SIZE = 1UL << LEVEL_BITS;
+
+    static constexpr std::uintptr_t ARENA_MASK = MAX_ARENAS - 1;
+
+    using Leaf = std::array<std::atomic<std::uintptr_t>, LEVEL_SIZE>;
+    using Node = std::array<std::atomic<Leaf *>, LEVEL_SIZE>;
+
+    static std::array<std::atomic<Node *>, LEVEL_SIZE> root;
+
+    // leaf returns a leaf which holds given page.
+    // It allocates missing nodes if create is true or returns nullptr otherwise
+    static Leaf *leaf(std::uintptr_t page, bool create);
+
+    // entry returns entry of page of given address or zero if there is none
+    [[nodiscard]] static std::uintptr_t entry(std::uintptr_t addr) noexcept;
+
+  public:
+    // get returns Span which given address belongs to
+    // or nullptr if there is no such Span
+    [[nodiscard]] static Span *get(std::uintptr_t addr) noexcept;
+
+    // arena returns index of arena which has mapped page of given address
+    // or zero if it is unknown
+    [[nodiscard]] static std::size_t arena(std::uintptr_t addr) noexcept;
+
+    // set maps all pages in range [addr, addr + size) to given Span
+    // keeping their arena.
+    // NOTE: addr and size should be multiples of 1 << PAGE_SHIFT
+    static void set(std::uintptr_t addr, std::size_t size, Span *span);
+
+    // setArena maps all pages in range [addr, addr + size) to given arena
+    // and to no Span, since they have just been mapped.
+    // NOTE: addr and size should be multiples of 1 << PAGE_SHIFT,
+    // arena should be less than MAX_ARENAS
+    static void setArena(std::uintptr_t addr, std::size_t size, std::size_t arena);
+};
+
+} // namespace hse::memory
+
+#endif // PAGE_MAP_H
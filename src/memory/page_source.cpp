@@ -0,0 +1,110 @@
+#include "page_source.h"
+#include "math/math.h"
+#include "page_map.h"
+#include "stats.h"
+#include "system/system.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace hse::memory {
+
+std::uintptr_t PageSource::alloc(std::size_t size) {
+    if (size > REGION_SIZE / 4) {
+        // it would waste most of the rest of region
+        auto addr = this->reserve(size);
+        try {
+            system::commit(addr, size);
+            this->tag(addr, size);
+        } catch (...) {
+            PageSource::unmap(addr, size);
+            throw;
+        }
+        Stats::add(Stats::mapped, size);
+        return addr;
+    }
+
+    if (this->end_ - this->next_ < size) {
+        auto region = this->reserve(REGION_SIZE);
+        if (this->next_ != this->end_) {
+            // rest of region has never been used
+            PageSource::unmap(this->next_, this->end_ - this->next_);
+        }
+        this->next_ = this->committed_ = region;
+        this->end_ = region + REGION_SIZE;
+    }
+
+    if (this->next_ + size > this->committed_) {
+        auto committed = std::min(math::roundUp(this->next_ + size, COMMIT_SIZE), this->end_);
+        system::commit(this->committed_, committed - this->committed_);
+        this->committed_ = committed;
+    }
+
+    auto addr = this->next_;
+    this->tag(addr, size);
+    this->next_ += size;
+    Stats::add(Stats::mapped, size);
+    return addr;
+}
+
+void PageSource::tag(std::uintptr_t addr, std::size_t size) const {
+    if (this->tagged_) {
+        PageMap::setArena(addr, size, this->arena_);
+    }
+}
+
+std::uintptr_t PageSource::reserve(std::size_t size) const {
+    // reserve enough space to cut aligned range out of it
+    auto reservedSize = size + REGION_SIZE - system::PAGE_SIZE();
+    auto addr = system::reserve(reservedSize);
+    Stats::add(Stats::mmaps, 1);
+    auto aligned = math::roundUp(addr, REGION_SIZE);
+    if (aligned != addr) {
+        PageSource::unmap(addr, aligned - addr);
+    }
+    if (auto end = aligned + size; end != addr + reservedSize) {
+        PageSource::unmap(end, addr + reservedSize - end);
+    }
+
+    if (this->hugePages_) {
+        system::adviseHugePages(aligned, size);
+    }
+    if (this->bindNode_) {
+        system::bindNode(aligned, size, this->arena_);
+    }
+    return aligned;
+}
+
+bool PageSource::mayStartMapping(std::uintptr_t addr) noexcept {
+    return addr % REGION_SIZE == 0;
+}
+
+void PageSource::unmap(std::uintptr_t addr, std::size_t size) {
+    system::munmap(addr, size);
+    Stats::add(Stats::munmaps, 1);
+}
+
+bool PageSource::hugePages() const noexcept {
+    return this->hugePages_;
+}
+
+void PageSource::setHugePages(bool hugePages) noexcept {
+    this->hugePages_ = hugePages;
+}
+
+std::size_t PageSource::arena() const noexcept {
+    return this->arena_;
+}
+
+bool PageSource::tagged() const noexcept {
+    return this->tagged_;
+}
+
+void PageSource::setArena(std::size_t arena, bool bindNode) noexcept {
+    this->arena_ = arena;
+    this->tagged_ = true;
+    this->bindNode_ = bindNode;
+}
+
+} // namespace hse::memory
@@ -0,0 +1,101 @@
+#ifndef PAGE_SOURCE_H
+#define PAGE_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hse::memory {
+
+// PageSource maps fresh pages for chunks, spans and large allocations.
+// It reserves address space in large regions without access to it
+// and commits their pages one after another as they are requested,
+// so that neighbouring chunks are adjacent and share a single mapping.
+// Requests too large for a region are mapped separately.
+// Every reservation starts at a multiple of REGION_SIZE, so that pages
+// of different reservations meet only at such addresses. Pages moved
+// by mremap leave their reservation for an address chosen by the system,
+// which can be next to any other mapping, so their owner tracks them
+// as separate mappings.
+// In huge pages mode the kernel is advised to back regions
+// with transparent huge pages.
+// PageSource of an arena records it in PageMap for every mapped page
+// and can bind reserved address space to NUMA node of the arena.
+// PageSource is not thread-safe.
+class PageSource {
+  public:
+    // HUGE_PAGE_SIZE is a size of transparent huge page
+    static constexpr std::size_t HUGE_PAGE_SIZE = 1UL << 21U;
+
+    // REGION_SIZE is a size of address space reserved at once
+    static constexpr std::size_t REGION_SIZE = 1UL << 26U;
+
+    // COMMIT_SIZE is a minimal size of pages committed at once
+    static constexpr std::size_t COMMIT_SIZE = 1UL << 20U;
+
+    static_assert(REGION_SIZE % HUGE_PAGE_SIZE == 0);
+
+  private:
+    bool hugePages_;
+
+    // arena_ is an index of arena which is recorded in PageMap
+    // for mapped pages if tagged_ is true
+    std::size_t arena_;
+    bool tagged_;
+
+    // bindNode_ is true if reserved address space is bound
+    // to NUMA node with index arena_
+    bool bindNode_;
+
+    // next_ points to the first unused page of current region,
+    // pages before committed_ are available for READ and WRITE
+    // and end_ points to the end of current region
+    std::uintptr_t next_;
+    std::uintptr_t committed_;
+    std::uintptr_t end_;
+
+    // reserve reserves address space of given size aligned to REGION_SIZE
+    [[nodiscard]] std::uintptr_t reserve(std::size_t size) const;
+
+    // tag records arena in PageMap for given range of pages if needed
+    void tag(std::uintptr_t addr, std::size_t size) const;
+
+    // unmap unmaps given range of address space which has never been used
+    static void unmap(std::uintptr_t addr, std::size_t size);
+
+  public:
+    constexpr PageSource() noexcept
+        : hugePages_(false), arena_(0), tagged_(false), bindNode_(false),
+          next_(0), committed_(0), end_(0) {}
+
+    // alloc maps fresh pages of given size filled with zeros.
+    // NOTE: size should be a multiple of page size
+    [[nodiscard]] std::uintptr_t alloc(std::size_t size);
+
+    // mayStartMapping returns if given address can be the start of
+    // a reservation, so that pages before and after it can belong
+    // to different mappings
+    [[nodiscard]] static bool mayStartMapping(std::uintptr_t addr) noexcept;
+
+    // hugePages returns if huge pages mode is enabled
+    [[nodiscard]] bool hugePages() const noexcept;
+
+    // setHugePages enables or disables huge pages mode.
+    // It affects only regions reserved afterwards
+    void setHugePages(bool hugePages) noexcept;
+
+    // arena returns index of arena pages are mapped for
+    [[nodiscard]] std::size_t arena() const noexcept;
+
+    // tagged returns if arena is recorded in PageMap for mapped pages
+    [[nodiscard]] bool tagged() const noexcept;
+
+    // setArena makes PageSource record given arena in PageMap for every
+    // page mapped afterwards and bind them to NUMA node with the same
+    // index if bindNode is true. It should be called before the first alloc.
+    // NOTE: arena should be less than PageMap::MAX_ARENAS
+    void setArena(std::size_t arena, bool bindNode) noexcept;
+};
+
+} // namespace hse::memory
+
+#endif // PAGE_SOURCE_H
@@ -0,0 +1,76 @@
+#include "quick_cache.h"
+#include "math/math.h"
+#include "memory_control_block.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace hse::memory {
+
+bool QuickCache::fits(std::size_t size) noexcept {
+    return size <= MAX_SIZE;
+}
+
+bool QuickCache::empty() const noexcept {
+    return this->count_ == 0;
+}
+
+bool QuickCache::full() const noexcept {
+    return this->count_ == CAPACITY;
+}
+
+void QuickCache::push(MemoryControlBlock *mcb) noexcept {
+    auto bin = mcb->size() / MemoryControlBlock::ALIGNMENT;
+    MemoryControlBlock::setNextFree(mcb, this->bins_[bin]);
+    this->bins_[bin] = mcb;
+    ++this->count_;
+
+    auto &word = this->nonEmpty_[bin / BITMAP_WORD_BITS];
+    word = math::setNthBit(word, bin % BITMAP_WORD_BITS);
+}
+
+MemoryControlBlock *QuickCache::pop(std::size_t size, std::size_t alignment) noexcept {
+    if (this->count_ == 0) {
+        return nullptr;
+    }
+
+    for (auto bin = size / MemoryControlBlock::ALIGNMENT;
+         bin < BINS && bin * MemoryControlBlock::ALIGNMENT < size + SLACK; ++bin) {
+        MemoryControlBlock *prev = nullptr;
+        for (auto *mcb = this->bins_[bin]; mcb != nullptr; prev = mcb, mcb = mcb->nextFree()) {
+            if (MemoryControlBlock::data(mcb) % alignment != 0) {
+                continue;
+            }
+
+            if (prev != nullptr) {
+                MemoryControlBlock::setNextFree(prev, mcb->nextFree());
+            } else if ((this->bins_[bin] = mcb->nextFree()) == nullptr) {
+                auto &word = this->nonEmpty_[bin / BITMAP_WORD_BITS];
+                word = math::clearNthBit(word, bin % BITMAP_WORD_BITS);
+            }
+            --this->count_;
+            return mcb;
+        }
+    }
+    return nullptr;
+}
+
+std::size_t QuickCache::take(std::span<MemoryControlBlock *, CAPACITY> mcbs) noexcept {
+    std::size_t count = 0;
+    for (std::size_t word = 0; word < this->nonEmpty_.size(); ++word) {
+        for (auto bits = this->nonEmpty_[word]; bits != 0; bits &= bits - 1) {
+            auto &bin = this->bins_[word * BITMAP_WORD_BITS + std::countr_zero(bits)];
+            for (auto *mcb = bin; mcb != nullptr; mcb = mcb->nextFree()) {
+                mcbs[count++] = mcb;
+            }
+            bin = nullptr;
+        }
+        this->nonEmpty_[word] = 0;
+    }
+    this->count_ = 0;
+    return count;
+}
+
+} // namespace hse::memory
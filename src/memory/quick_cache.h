@@ -0,0 +1,88 @@
+#ifndef QUICK_CACHE_H
+#define QUICK_CACHE_H
+
+#include "memory_control_block.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace hse::memory {
+
+// QuickCache holds recently freed blocks of medium sizes as they are,
+// so that the next allocation of the same size takes a block back
+// with a few pointer writes instead of merging it with its neighbors
+// on free and splitting it again on allocation.
+// Cached blocks stay marked busy, so neighbors never absorb them,
+// and they are linked through their nextFree_.
+// There is a bin for every size up to MAX_SIZE.
+// QuickCache is not thread-safe.
+class QuickCache {
+  public:
+    // MAX_SIZE is a maximum size of cached block
+    static constexpr std::size_t MAX_SIZE = 8192;
+
+    // CAPACITY is a maximum number of cached blocks
+    static constexpr std::size_t CAPACITY = 64;
+
+  private:
+    static constexpr std::size_t BINS = MAX_SIZE / MemoryControlBlock::ALIGNMENT + 1;
+
+    static constexpr std::size_t BITMAP_WORD_BITS = std::numeric_limits<std::uint64_t>::digits;
+
+    // SLACK is a size by which block can exceed requested one without
+    // being split, which is enough for a header and the smallest block
+    static constexpr std::size_t SLACK = sizeof(MemoryControlBlock) + MemoryControlBlock::ALIGNMENT;
+
+    std::array<MemoryControlBlock *, BINS> bins_;
+
+    // nonEmpty_ holds a bit for every bin, which is set if bin is not empty,
+    // so that taking all blocks does not visit empty bins
+    std::array<std::uint64_t, (BINS + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS> nonEmpty_;
+
+    std::size_t count_;
+
+  public:
+    constexpr QuickCache() noexcept : bins_{}, nonEmpty_{}, count_(0) {}
+
+    // fits returns if block of given size can be cached
+    [[nodiscard]] static bool fits(std::size_t size) noexcept;
+
+    // empty returns if there are no cached blocks
+    [[nodiscard]] bool empty() const noexcept;
+
+    // full returns if no more blocks can be cached
+    [[nodiscard]] bool full() const noexcept;
+
+    // push caches given busy block.
+    // NOTE: cache should not be full and block should fit into it
+    void push(MemoryControlBlock *mcb) noexcept;
+
+    // pop returns cached block, which fits given size, is too small
+    // to be split and has data aligned with given alignment,
+    // or nullptr if there is no such block.
+    // Blocks freed by aligned allocations are taken back by the next ones
+    // of the same size without shifting them.
+    [[nodiscard]] MemoryControlBlock *pop(std::size_t size,
+        std::size_t alignment = MemoryControlBlock::ALIGNMENT) noexcept;
+
+    // take moves all cached blocks to given array
+    // and returns their number
+    std::size_t take(std::span<MemoryControlBlock *, CAPACITY> mcbs) noexcept;
+
+    // forEach calls given function for every cached block
+    template<typename F>
+    void forEach(F f) const {
+        for (const auto *mcb : this->bins_) {
+            for (; mcb != nullptr; mcb = mcb->nextFree()) {
+                f(mcb);
+            }
+        }
+    }
+};
+
+} // namespace hse::memory
+
+#endif // QUICK_CACHE_H
@@ -0,0 +1,88 @@
+#ifndef SIZE_CLASS_H
+#define SIZE_CLASS_H
+
+#include "math/math.h"
+#include "memory_control_block.h"
+
+#include <bit>
+#include <cstddef>
+
+namespace hse::memory {
+
+// Small sizes are grouped into size classes: 16-byte steps up to 256 bytes
+// and then four classes per every doubling up to SMALL_SIZE_MAX.
+// Blocks of the same class are interchangeable, so they can be cached
+// and reused without looking for a fitting block.
+// Every slot is aligned with the largest power of two which divides
+// its size, so that aligned allocations are served by classes whose
+// sizes are multiples of their alignment without any padding.
+
+// SMALL_SIZE_MAX is a maximum size which has a size class
+constexpr std::size_t SMALL_SIZE_MAX = 1024;
+
+// SIZE_CLASSES is a number of size classes
+constexpr std::size_t SIZE_CLASSES = 24;
+
+namespace detail {
+constexpr std::size_t LINEAR_CLASSES = 16;
+constexpr std::size_t LINEAR_SIZE_MAX = LINEAR_CLASSES * MemoryControlBlock::ALIGNMENT;
+constexpr std::size_t CLASSES_PER_DOUBLING = 4;
+} // namespace detail
+
+// sizeClass returns the smallest size class which can hold given size.
+// NOTE: size should not be zero and should not exceed SMALL_SIZE_MAX
+constexpr std::size_t sizeClass(std::size_t size) noexcept {
+    if (size <= detail::LINEAR_SIZE_MAX) {
+        return (size - 1) / MemoryControlBlock::ALIGNMENT;
+    }
+    auto log = math::log2(size - 1);
+    return detail::LINEAR_CLASSES
+        + (log - math::log2(detail::LINEAR_SIZE_MAX)) * detail::CLASSES_PER_DOUBLING
+        + (((size - 1) >> (log - 2)) & (detail::CLASSES_PER_DOUBLING - 1));
+}
+
+// classSize returns the size of blocks of given size class
+constexpr std::size_t classSize(std::size_t sizeClass) noexcept {
+    if (sizeClass < detail::LINEAR_CLASSES) {
+        return (sizeClass + 1) * MemoryControlBlock::ALIGNMENT;
+    }
+    auto doublings = (sizeClass - detail::LINEAR_CLASSES) / detail::CLASSES_PER_DOUBLING;
+    auto step = (sizeClass - detail::LINEAR_CLASSES) % detail::CLASSES_PER_DOUBLING;
+    auto base = detail::LINEAR_SIZE_MAX << doublings;
+    return base + (step + 1) * (base / detail::CLASSES_PER_DOUBLING);
+}
+
+// classAlignment returns the alignment of slots of given size class
+constexpr std::size_t classAlignment(std::size_t sizeClass) noexcept {
+    return std::size_t{1} << std::countr_zero(classSize(sizeClass));
+}
+
+// hasSizeClass returns if memory of given size aligned with given alignment
+// can be served from slots of a size class.
+// NOTE: alignment should be a power of two
+constexpr bool hasSizeClass(std::size_t size, std::size_t alignment) noexcept {
+    return alignment <= SMALL_SIZE_MAX && math::roundUp(size, alignment) <= SMALL_SIZE_MAX;
+}
+
+// alignedSizeClass returns the smallest size class which can hold given size
+// and whose slots are aligned with given alignment.
+// NOTE: size should not be zero and hasSizeClass(size, alignment) should be true
+constexpr std::size_t alignedSizeClass(std::size_t size, std::size_t alignment) noexcept {
+    if (alignment <= MemoryControlBlock::ALIGNMENT) {
+        return sizeClass(size);
+    }
+    // SMALL_SIZE_MAX is a power of two, so the search always stops at it
+    auto aligned = sizeClass(math::roundUp(size, alignment));
+    while (classSize(aligned) % alignment != 0) {
+        ++aligned;
+    }
+    return aligned;
+}
+
+static_assert(classSize(SIZE_CLASSES - 1) == SMALL_SIZE_MAX);
+static_assert(math::isPowerOf2(SMALL_SIZE_MAX));
+static_assert(sizeClass(SMALL_SIZE_MAX) == SIZE_CLASSES - 1);
+
+} // namespace hse::memory
+
+#endif // SIZE_CLASS_H
@@ -0,0 +1,148 @@
+#include "slab_allocator.h"
+#include "page_map.h"
+#include "random/random.h"
+#include "span.h"
+#include "stats.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace hse::memory {
+
+std::uintptr_t SlabAllocator::alloc(std::size_t sizeClass) {
+    if (this->pending_.load(std::memory_order_relaxed) != nullptr) {
+        this->drainPending();
+    }
+
+    auto *span = this->partial_[sizeClass];
+    if (span == nullptr) {
+        span = this->allocSpan(sizeClass);
+    }
+
+    auto ptr = span->alloc();
+    if (span->full()) {
+        this->unlink(span);
+    }
+    Stats::add(Stats::allocated, span->slotSize());
+    Stats::add(Stats::slots[sizeClass], 1);
+    return ptr;
+}
+
+std::size_t SlabAllocator::allocBatch(std::size_t sizeClass, std::span<std::uintptr_t> ptrs) {
+    if (this->pending_.load(std::memory_order_relaxed) != nullptr) {
+        this->drainPending();
+    }
+
+    std::size_t count = 0;
+    try {
+        while (count < ptrs.size()) {
+            auto *span = this->partial_[sizeClass];
+            if (span == nullptr) {
+                span = this->allocSpan(sizeClass);
+            }
+
+            while (count < ptrs.size() && !span->full()) {
+                ptrs[count++] = span->alloc();
+            }
+            if (span->full()) {
+                this->unlink(span);
+            }
+        }
+    } catch (...) {
+        if (count == 0) {
+            throw;
+        }
+    }
+
+    // statistics are updated once for the whole batch
+    Stats::add(Stats::allocated, count * classSize(sizeClass));
+    Stats::add(Stats::slots[sizeClass], count);
+    return count;
+}
+
+void SlabAllocator::free(Span *span, std::uintptr_t ptr) {
+    auto wasFull = span->full();
+    span->free(ptr);
+    Stats::sub(Stats::allocated, span->slotSize());
+    Stats::sub(Stats::slots[span->sizeClass()], 1);
+
+    if (wasFull) {
+        // span has got a free slot
+        Span::link(span, this->partial_[span->sizeClass()]);
+        Span::link(nullptr, span);
+        this->partial_[span->sizeClass()] = span;
+        return;
+    }
+
+    // keep the only span of size class to avoid mapping it again
+    // on the next allocation
+    if (span->empty() && (span->prev() != nullptr || span->next() != nullptr)) {
+        this->freeSpan(span);
+    }
+}
+
+void SlabAllocator::freeRemote(Span *span, std::uintptr_t ptr) noexcept {
+    if (!span->pushRemote(ptr)) {
+        // span is already pending
+        return;
+    }
+
+    auto *head = this->pending_.load(std::memory_order_relaxed);
+    do {
+        span->setPendingNext(head);
+    } while (!this->pending_.compare_exchange_weak(head, span,
+        std::memory_order_release, std::memory_order_relaxed));
+}
+
+void SlabAllocator::drainPending() {
+    auto *span = this->pending_.exchange(nullptr, std::memory_order_acquire);
+    while (span != nullptr) {
+        // span can be pushed again as soon as its slots are taken
+        auto *next = span->pendingNext();
+        for (auto slot = span->takeRemote(); slot != 0;) {
+            // span can be released with its last slot
+            auto nextSlot = *reinterpret_cast<std::uintptr_t *>(slot);
+            this->free(span, slot);
+            slot = nextSlot;
+        }
+        span = next;
+    }
+}
+
+Span *SlabAllocator::allocSpan(std::size_t sizeClass) {
+    auto addr = this->chunks_->alloc(SPAN_SIZE);
+    if (addr == 0) {
+        addr = this->pages_->alloc(SPAN_SIZE);
+    }
+
+    auto *span = Span::create(addr, SPAN_SIZE, sizeClass, randomization() == Randomization::SLOTS);
+    try {
+        PageMap::set(addr, SPAN_SIZE, span);
+    } catch (...) {
+        this->chunks_->free(addr, SPAN_SIZE);
+        throw;
+    }
+
+    Span::link(span, this->partial_[sizeClass]);
+    this->partial_[sizeClass] = span;
+    return span;
+}
+
+void SlabAllocator::freeSpan(Span *span) {
+    this->unlink(span);
+    PageMap::set(span->addr(), span->size(), nullptr);
+    this->chunks_->free(span->addr(), span->size());
+}
+
+void SlabAllocator::unlink(Span *span) noexcept {
+    if (this->partial_[span->sizeClass()] == span) {
+        this->partial_[span->sizeClass()] = span->next();
+    }
+    Span::link(span->prev(), span->next());
+    Span::link(nullptr, span);
+    Span::link(span, nullptr);
+}
+
+} // namespace hse::memory
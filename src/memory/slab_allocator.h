@@ -0,0 +1,79 @@
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include "chunk_cache.h"
+#include "page_source.h"
+#include "size_class.h"
+#include "span.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace hse::memory {
+
+// SlabAllocator serves allocations of small size classes from Spans,
+// so that small allocations do not carry a MemoryControlBlock header.
+// It keeps a list of spans with free slots for every size class.
+// SlabAllocator is not thread-safe except for freeRemote: slots freed
+// by it are kept in lock-free lists of their spans, which are returned
+// to spans in a batch on the next allocation.
+class SlabAllocator {
+  public:
+    // SPAN_SIZE is a size of every run of pages carved into slots
+    static constexpr std::size_t SPAN_SIZE = 1UL << 16U;
+
+  private:
+    // chunks_ is a source of retained pages for spans
+    ChunkCache *chunks_;
+
+    // pages_ is a source of fresh pages for spans
+    PageSource *pages_;
+
+    // partial_ holds for every size class a list of spans with free slots
+    std::array<Span *, SIZE_CLASSES> partial_;
+
+    // pending_ is a lock-free stack of spans with remotely freed slots
+    std::atomic<Span *> pending_;
+
+    // drainPending returns remotely freed slots of pending spans to them
+    void drainPending();
+
+    // allocSpan allocates new span of given size class
+    // and puts it to the list of spans with free slots
+    Span *allocSpan(std::size_t sizeClass);
+
+    // freeSpan removes given empty span from the list
+    // of spans with free slots and releases its memory
+    void freeSpan(Span *span);
+
+    // unlink removes given span from the list of spans with free slots
+    void unlink(Span *span) noexcept;
+
+  public:
+    constexpr SlabAllocator(ChunkCache &chunks, PageSource &pages) noexcept
+        : chunks_(&chunks), pages_(&pages), partial_{}, pending_(nullptr) {}
+
+    // alloc returns a pointer to a free slot of given size class
+    [[nodiscard]] std::uintptr_t alloc(std::size_t sizeClass);
+
+    // allocBatch fills given ptrs with free slots of given size class.
+    // It returns the number of allocated slots, which is less than
+    // ptrs.size() only if memory ran out in the middle of the batch
+    [[nodiscard]] std::size_t allocBatch(std::size_t sizeClass, std::span<std::uintptr_t> ptrs);
+
+    // free releases slot pointed by ptr back to given span,
+    // which it belongs to
+    void free(Span *span, std::uintptr_t ptr);
+
+    // freeRemote releases slot pointed by ptr back to given span
+    // as free does, but without modifying the span or lists of spans,
+    // so that it can be called concurrently with any other calls
+    void freeRemote(Span *span, std::uintptr_t ptr) noexcept;
+};
+
+} // namespace hse::memory
+
+#endif // SLAB_ALLOCATOR_H
@@ -0,0 +1,181 @@
+#include "span.h"
+#include "math/math.h"
+#include "memory_control_block.h"
+#include "page_map.h"
+#include "random/random.h"
+#include "size_class.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace hse::memory {
+
+Span *Span::create(std::uintptr_t addr, std::size_t size, std::size_t sizeClass, bool shuffled) noexcept {
+    auto *span = new (reinterpret_cast<void *>(addr)) Span;
+    span->sizeClass_ = sizeClass;
+    span->slotSize_ = classSize(sizeClass);
+    span->size_ = size;
+    span->used_ = 0;
+    // run of pages is page-aligned, so every slot gets alignment of its class
+    span->bump_ = math::roundUp(addr + sizeof(Span), classAlignment(sizeClass));
+    span->freeList_ = 0;
+    span->prev_ = nullptr;
+    span->next_ = nullptr;
+    span->remoteFree_.store(0, std::memory_order_relaxed);
+    span->pendingNext_ = nullptr;
+    span->mapping_ = 0;
+    if (shuffled) {
+        span->shuffle();
+    }
+    return span;
+}
+
+void Span::shuffle() noexcept {
+    auto count = (this->end() - this->bump_) / this->slotSize_;
+    if (count == 0) {
+        return;
+    }
+    auto slot = [this](std::size_t i) { return this->bump_ + i * this->slotSize_; };
+    // permutation of slots is kept in their second words,
+    // since the first ones are overwritten by links
+    auto index = [&slot](std::size_t i) -> std::uintptr_t & {
+        return reinterpret_cast<std::uintptr_t *>(slot(i))[1];
+    };
+    static_assert(MemoryControlBlock::ALIGNMENT >= 2 * sizeof(std::uintptr_t));
+
+    for (std::size_t i = 0; i < count; ++i) {
+        index(i) = i;
+    }
+    auto &random = threadRandom();
+    for (std::size_t i = count - 1; i > 0; --i) {
+        std::swap(index(i), index(uniform_int_distribution<std::size_t>(0, i)(random)));
+    }
+
+    std::uintptr_t next = this->freeList_;
+    for (std::size_t i = count; i > 0; --i) {
+        auto ptr = slot(index(i - 1));
+        *reinterpret_cast<std::uintptr_t *>(ptr) = next;
+        next = ptr;
+    }
+    this->freeList_ = next;
+    this->bump_ = this->end();
+}
+
+Span *Span::createLarge(std::uintptr_t addr, std::size_t size, std::size_t mapping) noexcept {
+    auto *span = new (reinterpret_cast<void *>(addr)) Span;
+    span->sizeClass_ = Span::LARGE;
+    span->slotSize_ = 0;
+    span->size_ = size;
+    span->used_ = 1;
+    span->bump_ = span->end();
+    span->freeList_ = 0;
+    span->prev_ = nullptr;
+    span->next_ = nullptr;
+    span->remoteFree_.store(0, std::memory_order_relaxed);
+    span->pendingNext_ = nullptr;
+    span->mapping_ = mapping;
+    return span;
+}
+
+Span *Span::fromPtr(std::uintptr_t ptr) noexcept {
+    return PageMap::get(ptr);
+}
+
+std::uintptr_t Span::addr() const noexcept {
+    return reinterpret_cast<std::uintptr_t>(this);
+}
+
+std::uintptr_t Span::end() const noexcept {
+    return this->addr() + this->size_;
+}
+
+std::size_t Span::size() const noexcept {
+    return this->size_;
+}
+
+std::size_t Span::sizeClass() const noexcept {
+    return this->sizeClass_;
+}
+
+bool Span::large() const noexcept {
+    return this->sizeClass_ == Span::LARGE;
+}
+
+std::size_t Span::mapping() const noexcept {
+    return this->mapping_;
+}
+
+std::size_t Span::slotSize() const noexcept {
+    return this->slotSize_;
+}
+
+bool Span::full() const noexcept {
+    return this->freeList_ == 0 && this->bump_ + this->slotSize_ > this->end();
+}
+
+bool Span::empty() const noexcept {
+    return this->used_ == 0;
+}
+
+std::uintptr_t Span::alloc() noexcept {
+    ++this->used_;
+    if (auto slot = this->freeList_; slot != 0) {
+        this->freeList_ = *reinterpret_cast<std::uintptr_t *>(slot);
+        return slot;
+    }
+
+    auto slot = this->bump_;
+    this->bump_ += this->slotSize_;
+    return slot;
+}
+
+void Span::free(std::uintptr_t ptr) noexcept {
+    --this->used_;
+    *reinterpret_cast<std::uintptr_t *>(ptr) = this->freeList_;
+    this->freeList_ = ptr;
+}
+
+bool Span::pushRemote(std::uintptr_t ptr) noexcept {
+    auto head = this->remoteFree_.load(std::memory_order_relaxed);
+    do {
+        *reinterpret_cast<std::uintptr_t *>(ptr) = head;
+    } while (!this->remoteFree_.compare_exchange_weak(head, ptr,
+        std::memory_order_acq_rel, std::memory_order_relaxed));
+    // pendingNext_ is read before the list is taken, so that the span
+    // can be linked again once the list becomes empty
+    return head == 0;
+}
+
+std::uintptr_t Span::takeRemote() noexcept {
+    return this->remoteFree_.exchange(0, std::memory_order_acq_rel);
+}
+
+Span *Span::pendingNext() const noexcept {
+    return this->pendingNext_;
+}
+
+void Span::setPendingNext(Span *next) noexcept {
+    this->pendingNext_ = next;
+}
+
+Span *Span::prev() const noexcept {
+    return this->prev_;
+}
+
+Span *Span::next() const noexcept {
+    return this->next_;
+}
+
+void Span::link(Span *prev, Span *next) noexcept {
+    if (prev != nullptr) {
+        prev->next_ = next;
+    }
+    if (next != nullptr) {
+        next->prev_ = prev;
+    }
+}
+
+} // namespace hse::memory
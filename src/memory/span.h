@@ -0,0 +1,140 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace hse::memory {
+
+// Span is placed at the beginning of a run of pages, which is either carved
+// into slots of a single size class or holds a single large allocation.
+// Slots have no headers: size of a slot is recovered from the Span
+// found by PageMap.
+// The first slot is aligned with alignment of the size class,
+// so that every slot is aligned with it.
+// Slots which have never been allocated are handed out by bumping
+// a pointer, freed ones are kept in a list embedded into slots themselves.
+// Shuffled spans link all their slots to the list in random order instead.
+// Slots freed without the lock of the owner are kept in a separate
+// lock-free list until the owner takes them.
+class Span {
+  public:
+    // LARGE is a size class of spans holding a single large allocation
+    static constexpr std::size_t LARGE = ~std::size_t{0};
+
+  private:
+    std::size_t sizeClass_;
+    std::size_t slotSize_;
+
+    // size_ is a size of the whole run of pages including this header
+    std::size_t size_;
+
+    // used_ is a number of allocated slots
+    std::size_t used_;
+
+    // bump_ points to the first slot which has never been allocated
+    std::uintptr_t bump_;
+
+    // freeList_ points to the first freed slot.
+    // Every freed slot holds a pointer to the next one
+    std::uintptr_t freeList_;
+
+    // prev_ and next_ link spans of the same size class with free slots
+    Span *prev_;
+    Span *next_;
+
+    // remoteFree_ points to the first slot freed without the lock
+    // of the owner, which has not been taken by it yet
+    std::atomic<std::uintptr_t> remoteFree_;
+
+    // pendingNext_ links spans with remotely freed slots
+    Span *pendingNext_;
+
+    // mapping_ is a number of separate mapping of the system pages
+    // of large allocation belong to or zero for reservations of PageSource
+    std::size_t mapping_;
+
+    [[nodiscard]] std::uintptr_t end() const noexcept;
+
+    // shuffle links all slots which have never been allocated
+    // to the list of free slots in random order
+    void shuffle() noexcept;
+
+  public:
+    // create places a Span for given size class at the beginning
+    // of given run of pages and returns a pointer to it.
+    // Slots of shuffled span are handed out in random order
+    static Span *create(std::uintptr_t addr, std::size_t size, std::size_t sizeClass, bool shuffled = false) noexcept;
+
+    // createLarge places a Span for a single large allocation
+    // at the beginning of given run of pages of given mapping
+    // and returns a pointer to it
+    static Span *createLarge(std::uintptr_t addr, std::size_t size, std::size_t mapping = 0) noexcept;
+
+    // fromPtr returns Span which given pointer belongs to
+    // or nullptr if it does not belong to any Span
+    [[nodiscard]] static Span *fromPtr(std::uintptr_t ptr) noexcept;
+
+    // addr returns the beginning of run of pages
+    [[nodiscard]] std::uintptr_t addr() const noexcept;
+
+    // size returns the size of run of pages
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    // sizeClass returns size class of slots
+    [[nodiscard]] std::size_t sizeClass() const noexcept;
+
+    // large returns if span holds a single large allocation
+    [[nodiscard]] bool large() const noexcept;
+
+    // mapping returns number of separate mapping pages of large allocation
+    // belong to or zero if they belong to reservations of PageSource
+    [[nodiscard]] std::size_t mapping() const noexcept;
+
+    // slotSize returns the size of every slot in bytes
+    [[nodiscard]] std::size_t slotSize() const noexcept;
+
+    // full returns if there are no free slots
+    [[nodiscard]] bool full() const noexcept;
+
+    // empty returns if there are no allocated slots
+    [[nodiscard]] bool empty() const noexcept;
+
+    // alloc returns a pointer to a free slot and marks it as allocated.
+    // NOTE: span should not be full
+    [[nodiscard]] std::uintptr_t alloc() noexcept;
+
+    // free marks slot pointed by given pointer as free
+    void free(std::uintptr_t ptr) noexcept;
+
+    // pushRemote puts slot pointed by given pointer to the list of remotely
+    // freed slots with a single CAS. It is safe to call it concurrently
+    // with any other calls. It returns true if the list was empty.
+    bool pushRemote(std::uintptr_t ptr) noexcept;
+
+    // takeRemote empties the list of remotely freed slots
+    // and returns the first of them or zero if it is empty.
+    // Slots of returned list are still allocated
+    [[nodiscard]] std::uintptr_t takeRemote() noexcept;
+
+    // pendingNext returns next span with remotely freed slots
+    [[nodiscard]] Span *pendingNext() const noexcept;
+
+    // setPendingNext sets next span with remotely freed slots
+    void setPendingNext(Span *next) noexcept;
+
+    // prev returns previous span in the list
+    [[nodiscard]] Span *prev() const noexcept;
+
+    // next returns next span in the list
+    [[nodiscard]] Span *next() const noexcept;
+
+    // link links given spans one after another
+    // with any of them allowed to be nullptr
+    static void link(Span *prev, Span *next) noexcept;
+};
+
+} // namespace hse::memory
+
+#endif // SPAN_H
@@ -0,0 +1,64 @@
+#include "stats.h"
+#include "math/math.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace hse::memory {
+
+std::array<Stats::Shard, Stats::SHARDS> Stats::shards{};
+
+constinit const std::array<Stats::Counter, SIZE_CLASSES> Stats::slots = [] {
+    std::array<Counter, SIZE_CLASSES> counters{};
+    for (std::size_t i = 0; i < SIZE_CLASSES; ++i) {
+        counters[i] = Counter{SCALAR_COUNTERS + i};
+    }
+    return counters;
+}();
+
+namespace {
+
+// threads is a number of threads which have been assigned a shard
+std::atomic<std::size_t> threads{0};
+
+// thread is a shard of current thread plus one or zero
+// if it has not been assigned
+constinit thread_local std::size_t thread = 0;
+
+} // namespace
+
+Stats::Shard &Stats::shard() noexcept {
+    if (thread == 0) {
+        thread = threads.fetch_add(1, std::memory_order_relaxed) % SHARDS + 1;
+    }
+    return Stats::shards[thread - 1];
+}
+
+void Stats::add(Counter counter, std::size_t value) noexcept {
+    Stats::shard().values[counter.index].fetch_add(value, std::memory_order_relaxed);
+}
+
+void Stats::sub(Counter counter, std::size_t value) noexcept {
+    Stats::shard().values[counter.index].fetch_sub(value, std::memory_order_relaxed);
+}
+
+std::size_t Stats::get(Counter counter) noexcept {
+    // values wrapped around in separate shards add up to the exact sum
+    std::size_t sum = 0;
+    for (const auto &shard : Stats::shards) {
+        sum += shard.values[counter.index].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+std::size_t Stats::getLocal(Counter counter) noexcept {
+    return Stats::shard().values[counter.index].load(std::memory_order_relaxed);
+}
+
+std::size_t Stats::freeRange(std::size_t size) noexcept {
+    return size == 0 ? 0 : std::min<std::size_t>(math::log2(size), FREE_RANGES - 1);
+}
+
+} // namespace hse::memory
@@ -0,0 +1,116 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "size_class.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace hse::memory {
+
+// Stats holds process-wide counters of memory management.
+// Every counter is split into shards of threads, which are assigned
+// to threads round-robin and kept on separate cache lines, so that
+// threads of different NUMA nodes do not write the same line on every
+// allocation. Reading a counter sums all its shards. Counters decreased
+// by another thread than the one which increased them wrap around
+// in single shards, but their sums are exact.
+// Counters are updated with relaxed atomics, so that they are cheap
+// enough to be always enabled, but they are not consistent with each
+// other if read while memory is being allocated
+class Stats {
+  public:
+    // Counter identifies a counter in every shard
+    struct Counter {
+        std::size_t index;
+    };
+
+    // FREE_RANGES is a number of size ranges free blocks are counted in:
+    // range i holds blocks with size in [2^i, 2^(i+1)),
+    // the last one holds all larger blocks
+    static constexpr std::size_t FREE_RANGES = 32;
+
+    // SHARDS is a number of shards of every counter
+    static constexpr std::size_t SHARDS = 64;
+
+    // mapped is a size of pages obtained from the system
+    // for allocations and not returned to it yet
+    static constexpr Counter mapped{0};
+
+    // allocated is a size of allocated memory including slots
+    // cached by threads
+    static constexpr Counter allocated{1};
+
+    // mmaps is a number of mapped regions of address space
+    static constexpr Counter mmaps{2};
+
+    // munmaps is a number of unmapped ranges of address space
+    static constexpr Counter munmaps{3};
+
+    // reallocsInPlace, reallocsRemapped and reallocsCopied are numbers of
+    // reallocations which kept the address, moved pages without copying
+    // and copied data respectively
+    static constexpr Counter reallocsInPlace{4};
+    static constexpr Counter reallocsRemapped{5};
+    static constexpr Counter reallocsCopied{6};
+
+    // numaLocal and numaRemote are numbers of frees of memory owned
+    // by arena of NUMA node of the freeing thread and by arenas of other
+    // nodes respectively. They are counted only if there are several nodes
+    static constexpr Counter numaLocal{7};
+    static constexpr Counter numaRemote{8};
+
+  private:
+    static constexpr std::size_t SCALAR_COUNTERS = 9;
+
+    // CACHE_LINE_SIZE is a size of cache line shards are aligned to
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    // Shard holds values of all counters updated by a group of threads
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        std::array<std::atomic<std::size_t>, SCALAR_COUNTERS + SIZE_CLASSES> values;
+    };
+
+    static std::array<Shard, SHARDS> shards;
+
+    // shard returns shard of current thread, assigning it on the first call
+    [[nodiscard]] static Shard &shard() noexcept;
+
+  public:
+    // slots holds a number of allocated slots of every size class
+    static const std::array<Counter, SIZE_CLASSES> slots;
+
+    // add increases given counter by given value
+    static void add(Counter counter, std::size_t value) noexcept;
+
+    // sub decreases given counter by given value
+    static void sub(Counter counter, std::size_t value) noexcept;
+
+    // get returns value of given counter
+    [[nodiscard]] static std::size_t get(Counter counter) noexcept;
+
+    // getLocal returns value of given counter in shard of current thread,
+    // which follows changes made by current thread without summing shards.
+    // It differs from get by changes made by other threads
+    [[nodiscard]] static std::size_t getLocal(Counter counter) noexcept;
+
+    // freeRange returns index of range which holds free blocks of given size
+    [[nodiscard]] static std::size_t freeRange(std::size_t size) noexcept;
+};
+
+// FreeStats describes memory which is mapped but not allocated
+struct FreeStats {
+    // retained is a size of released pages retained for reuse
+    std::size_t retained;
+
+    // freeBytes is a total size of free blocks
+    std::size_t freeBytes;
+
+    // freeBlocks holds a number of free blocks in every size range
+    std::array<std::size_t, Stats::FREE_RANGES> freeBlocks;
+};
+
+} // namespace hse::memory
+
+#endif // STATS_H
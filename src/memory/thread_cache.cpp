@@ -0,0 +1,107 @@
+#include "thread_cache.h"
+#include "math/math.h"
+#include "memory_control_block.h"
+#include "random/random.h"
+#include "size_class.h"
+#include "span.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+namespace hse::memory {
+
+ThreadCache::~ThreadCache() {
+    this->capacity = 0;
+    this->flush();
+}
+
+std::uintptr_t ThreadCache::alloc(std::size_t size, std::size_t alignment) {
+    if (!hasSizeClass(size, alignment) || this->capacity == 0) {
+        return this->arenas->local().alloc(math::roundUp(size, MemoryControlBlock::ALIGNMENT),
+            std::max(alignment, MemoryControlBlock::ALIGNMENT));
+    }
+
+    auto sizeClass = alignedSizeClass(size, alignment);
+    auto &bin = this->bins[sizeClass];
+    if (bin.count == 0) {
+        this->refill(sizeClass);
+    }
+    if (randomization() == Randomization::SLOTS && bin.count > 1) {
+        // the most recently freed slot is not reused predictably
+        auto i = uniform_int_distribution<std::size_t>(0, bin.count - 1)(threadRandom());
+        std::swap(bin.blocks[i], bin.blocks[bin.count - 1]);
+    }
+    return bin.blocks[--bin.count];
+}
+
+void ThreadCache::free(std::uintptr_t ptr) {
+    auto *span = Span::fromPtr(ptr);
+    if (span == nullptr || span->large() || this->capacity == 0) {
+        this->arenas->owner(ptr).free(ptr);
+        return;
+    }
+    if (!this->isLocal(ptr)) {
+        this->arenas->freeRemote(std::span{&ptr, 1});
+        return;
+    }
+
+    this->push(this->bins[span->sizeClass()], ptr);
+}
+
+void ThreadCache::freeSized(std::uintptr_t ptr, std::size_t size, std::size_t alignment) {
+    if (!hasSizeClass(size, alignment) || this->capacity == 0) {
+        this->arenas->owner(ptr).free(ptr);
+        return;
+    }
+    if (!this->isLocal(ptr)) {
+        this->arenas->freeRemote(std::span{&ptr, 1});
+        return;
+    }
+
+    // slot of small size is found without looking up its span
+    this->push(this->bins[alignedSizeClass(size, alignment)], ptr);
+}
+
+bool ThreadCache::isLocal(std::uintptr_t ptr) {
+    if (this->arenas->single()) {
+        return true;
+    }
+
+    auto local = this->arenas->isLocal(ptr);
+    Stats::add(local ? Stats::numaLocal : Stats::numaRemote, 1);
+    return local;
+}
+
+void ThreadCache::push(Bin &bin, std::uintptr_t ptr) {
+    if (bin.count == this->capacity) {
+        this->spill(bin);
+    }
+    bin.blocks[bin.count++] = ptr;
+}
+
+void ThreadCache::flush() {
+    for (auto &bin : this->bins) {
+        this->arenas->freeBatch(std::span{bin.blocks.data(), bin.count});
+        bin.count = 0;
+    }
+}
+
+void ThreadCache::refill(std::size_t sizeClass) {
+    auto &bin = this->bins[sizeClass];
+    bin.count = this->arenas->local().allocBatch(classSize(sizeClass),
+        std::span{bin.blocks.data(), this->capacity / 2});
+}
+
+void ThreadCache::spill(Bin &bin) {
+    auto half = bin.count / 2;
+    // other threads are not blocked by spilled slots
+    this->arenas->freeRemote(std::span{bin.blocks.data(), half});
+    std::copy(bin.blocks.begin() + half, bin.blocks.begin() + bin.count, bin.blocks.begin());
+    bin.count -= half;
+}
+
+} // namespace hse::memory
@@ -0,0 +1,123 @@
+#ifndef THREAD_CACHE_H
+#define THREAD_CACHE_H
+
+#include "arenas.h"
+#include "memory_control_block.h"
+#include "random/random.h"
+#include "size_class.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace hse::memory {
+
+// ThreadCache keeps small slots freed by a single thread in bins
+// of size classes and serves allocations of small sizes from them
+// without any synchronization. Bins are refilled from the arena of NUMA
+// node of the thread in batches, so its lock is taken once per half
+// of a bin instead of once per call. Full bins are spilled without the lock.
+// Slots of other nodes are returned to their arenas instead of being cached.
+// In SLOTS randomization mode slots are taken from random places of bins.
+// ThreadCache itself is not thread-safe and should be used
+// as a thread_local object.
+class ThreadCache {
+  public:
+    // BIN_CAPACITY is a maximum number of blocks in a single bin
+    static constexpr std::size_t BIN_CAPACITY = 32;
+
+  private:
+    // Bin is a stack of free blocks of the same size class
+    struct Bin {
+        std::size_t count = 0;
+        std::array<std::uintptr_t, BIN_CAPACITY> blocks{};
+    };
+
+    Arenas *arenas;
+
+    // capacity is a maximum number of blocks in every bin.
+    // It is zero after destruction, so that late calls from
+    // other thread_local destructors go straight to arenas
+    std::size_t capacity;
+
+    std::array<Bin, SIZE_CLASSES> bins{};
+
+    // refill allocates half of bin capacity of blocks of given size class
+    void refill(std::size_t sizeClass);
+
+    // isLocal returns if given slot belongs to arena of NUMA node
+    // of current thread and counts its free in Stats if there are several
+    [[nodiscard]] bool isLocal(std::uintptr_t ptr);
+
+    // push puts given slot to given bin spilling the bin if it is full
+    void push(Bin &bin, std::uintptr_t ptr);
+
+    // spill releases older half of blocks in given bin back to arenas
+    void spill(Bin &bin);
+
+  public:
+    constexpr explicit ThreadCache(Arenas &arenas) noexcept
+        : arenas(&arenas), capacity(BIN_CAPACITY) {}
+
+    ThreadCache(const ThreadCache &) = delete;
+    ThreadCache &operator=(const ThreadCache &) = delete;
+
+    // ~ThreadCache releases all cached blocks back to arenas
+    ~ThreadCache();
+
+    // alloc returns a pointer to memory of at least size bytes aligned
+    // with given alignment. Small sizes with alignment are cached in bins
+    // of size classes whose slots are aligned with it.
+    // NOTE: size should not be zero and alignment should be a power of two
+    [[nodiscard]] std::uintptr_t alloc(std::size_t size,
+        std::size_t alignment = MemoryControlBlock::ALIGNMENT);
+
+    // tryAlloc pops a cached slot of given size and returns zero if there
+    // is none, in which case alloc should be called. It never takes locks
+    // or throws, so that operator new inlines it.
+    [[nodiscard]] std::uintptr_t tryAlloc(std::size_t size) noexcept {
+        // zero size wraps around and is left to alloc too
+        if (size - 1 >= SMALL_SIZE_MAX) {
+            return 0;
+        }
+        auto &bin = this->bins[sizeClass(size)];
+        if (bin.count == 0 || randomization() == Randomization::SLOTS) {
+            return 0;
+        }
+        return bin.blocks[--bin.count];
+    }
+
+    // tryFreeSized pushes slot of given size to its bin and returns false
+    // if it does not fit, in which case freeSized should be called.
+    // Only slots of a single arena are taken, which are always local.
+    // NOTE: size should be the one memory was allocated with
+    [[nodiscard]] bool tryFreeSized(std::uintptr_t ptr, std::size_t size) noexcept {
+        if (size - 1 >= SMALL_SIZE_MAX || !this->arenas->single()) {
+            return false;
+        }
+        auto &bin = this->bins[sizeClass(size)];
+        if (bin.count >= this->capacity) {
+            return false;
+        }
+        bin.blocks[bin.count++] = ptr;
+        return true;
+    }
+
+    // free deallocates memory pointed by given pointer, keeping it in
+    // the cache if it is a slot of a slab of the local arena
+    void free(std::uintptr_t ptr);
+
+    // freeSized deallocates memory of given size pointed by given pointer
+    // as free does. Slots of small sizes are cached without looking up
+    // their spans.
+    // NOTE: size and alignment should be the ones memory was allocated with
+    void freeSized(std::uintptr_t ptr, std::size_t size,
+        std::size_t alignment = MemoryControlBlock::ALIGNMENT);
+
+    // flush releases all cached blocks back to arenas
+    void flush();
+};
+
+} // namespace hse::memory
+
+#endif // THREAD_CACHE_H
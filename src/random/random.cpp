@@ -0,0 +1,98 @@
+#include "random.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef HAVE_GETRANDOM
+#include <sys/random.h>
+#endif
+
+namespace hse {
+
+namespace {
+
+// mode is current randomization mode of the process
+std::atomic<Randomization> mode{
+#if defined HSE_MALLOC_NO_RANDOM
+    Randomization::NONE
+#elif defined HSE_MALLOC_RANDOM_SLOTS
+    Randomization::SLOTS
+#else
+    Randomization::SHIFT
+#endif
+};
+
+// seed is a random seed of the process or zero if it has not been read yet.
+// It is not initialized dynamically, since allocations can be made
+// before static initialization of this file
+constinit std::atomic<std::uint64_t> seed{0};
+
+// threads is a number of threads which have seeded their generators
+std::atomic<std::uint64_t> threads{0};
+
+constinit thread_local wyrand generator{};
+constinit thread_local bool seeded = false;
+
+// mix scrambles bits of given value, so that generators of threads
+// seeded with successive values do not share their sequences
+constexpr std::uint64_t mix(std::uint64_t value) noexcept {
+    value = (value ^ (value >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27U)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31U);
+}
+
+// readSeed returns random value from the system without allocating memory
+std::uint64_t readSeed() noexcept {
+    std::uint64_t value = 0;
+#ifdef HAVE_GETRANDOM
+    auto *bytes = reinterpret_cast<std::uint8_t *>(&value);
+    for (std::size_t read = 0; read < sizeof(value);) {
+        auto n = ::getrandom(bytes + read, sizeof(value) - read, 0);
+        if (n == -1 && errno != EINTR) {
+            break;
+        }
+        read += n > 0 ? static_cast<std::size_t>(n) : 0;
+    }
+#endif
+    // addresses of the stack and the code are randomized by the system
+    value ^= timeToInt() ^ reinterpret_cast<std::uintptr_t>(&value)
+        ^ reinterpret_cast<std::uintptr_t>(&readSeed);
+    return value;
+}
+
+// processSeed returns the random seed of the process,
+// reading it on the first call
+std::uint64_t processSeed() noexcept {
+    if (auto value = seed.load(std::memory_order_acquire); value != 0) {
+        return value;
+    }
+    // concurrent first calls agree on the value which is stored first
+    std::uint64_t expected = 0;
+    auto value = readSeed() | 1U;
+    if (!seed.compare_exchange_strong(expected, value, std::memory_order_acq_rel)) {
+        return expected;
+    }
+    return value;
+}
+
+} // namespace
+
+Randomization randomization() noexcept {
+    return mode.load(std::memory_order_relaxed);
+}
+
+void setRandomization(Randomization randomization) noexcept {
+    mode.store(randomization, std::memory_order_relaxed);
+}
+
+wyrand &threadRandom() noexcept {
+    if (!seeded) {
+        generator = wyrand(mix(processSeed() + threads.fetch_add(1, std::memory_order_relaxed)));
+        seeded = true;
+    }
+    return generator;
+}
+
+} // namespace hse
@@ -11,34 +11,34 @@
 
 namespace hse {
 
-template <Integral IntType = std::uint64_t, IntType k1 = 8, IntType k2 = 69069, IntType b = 313>
-class squared_congruential_generator {
-    using result_type = IntType;
-    // init prng value
-    result_type __start;
+// wyrand is a 64-bit generator with a single word of state, which is
+// advanced by a constant and mixed with one wide multiplication per call
+class wyrand {
+    using result_type = std::uint64_t;
 
-    // peek the next value and do not chage state
-    result_type next(result_type start) const noexcept {
-        return k1 * start * start + k2 * start + b;
-    }
+    static constexpr result_type INCREMENT = 0xa0761d6478bd642fULL;
+    static constexpr result_type MIX = 0xe7037ed1a0b428dbULL;
+
+    result_type __state;
 
   public:
-    squared_congruential_generator() noexcept : __start(17) {}
+    constexpr wyrand() noexcept : __state(17) {}
 
-    // inititalize generator with statr value
-    squared_congruential_generator(result_type token) noexcept
-        : __start(token) {}
+    // initialize generator with start value
+    constexpr explicit wyrand(result_type token) noexcept : __state(token) {}
 
     // change state and return the next value
-    result_type operator()() noexcept {
-        __start = next(__start);
-        return next(__start);
+    constexpr result_type operator()() noexcept {
+        __state += INCREMENT;
+        result_type low = 0;
+        auto high = math::mulWide(__state, __state ^ MIX, &low);
+        return high ^ low;
     }
 
     // min and max possible values
-    result_type min() const noexcept { return 0; }
-    result_type max() const noexcept {
-        return std::numeric_limits<IntType>::max();
+    static constexpr result_type min() noexcept { return 0; }
+    static constexpr result_type max() noexcept {
+        return std::numeric_limits<result_type>::max();
     }
 };
 
@@ -53,8 +53,8 @@ class uniform_int_distribution {
   public:
     using result_type = IntType;
 
-    // initialize min and max value of distribution
-    // if the _max<=_min then generaor always renturns _min value
+    // initialize min and max value of distribution, both of which
+    // can be returned. If the _max<=_min then generaor always renturns _min value
     explicit uniform_int_distribution(
         IntType _min = 0,
         IntType _max = std::numeric_limits<IntType>::max()) noexcept
@@ -64,10 +64,28 @@ class uniform_int_distribution {
     result_type min() const noexcept { return __min; }
     result_type max() const noexcept { return __max; }
 
-    // returning random number from prng
-    template <PRNG<result_type> UniformRandomNumberGenerator>
+    // returning random number from prng, which should return uniformly
+    // distributed 64-bit values. It maps them to the range with
+    // multiplication instead of division and rejects the few values
+    // which would make the result biased (Lemire's method)
+    template <PRNG<std::uint64_t> UniformRandomNumberGenerator>
     result_type operator()(UniformRandomNumberGenerator &__prng) noexcept {
-        return min() + __prng() % (max() - min());
+        std::uint64_t range = static_cast<std::uint64_t>(max() - min()) + 1;
+        if (range == 0) {
+            // the whole range of 64-bit values
+            return static_cast<result_type>(min() + __prng());
+        }
+
+        std::uint64_t low = 0;
+        auto high = math::mulWide(__prng(), range, &low);
+        if (low < range) {
+            // division is needed only for rare values close to rejection
+            auto threshold = -range % range;
+            while (low < threshold) {
+                high = math::mulWide(__prng(), range, &low);
+            }
+        }
+        return static_cast<result_type>(min() + high);
     }
 };
 
@@ -88,7 +106,32 @@ IntType timeToInt() noexcept {
     return timeToInt(Clock::now());
 }
 
-typedef squared_congruential_generator<> sc69069_t;
+// Randomization is a way addresses of allocations are made unpredictable
+enum class Randomization : std::uint8_t {
+    // NONE hands out memory in a deterministic order
+    NONE,
+
+    // SHIFT places blocks at random offsets within free blocks
+    // found for them, which burns padding of up to their spare size
+    SHIFT,
+
+    // SLOTS hands out slots of slabs in random order without padding,
+    // while blocks are placed deterministically
+    SLOTS,
+};
+
+// randomization returns current randomization mode of the process.
+// It is SHIFT by default, SLOTS if HSE_MALLOC_RANDOM_SLOTS is defined
+// and NONE if HSE_MALLOC_NO_RANDOM is defined
+[[nodiscard]] Randomization randomization() noexcept;
+
+// setRandomization sets randomization mode of the process.
+// It affects only allocations made afterwards
+void setRandomization(Randomization mode) noexcept;
+
+// threadRandom returns PRNG of current thread. Every thread seeds its own
+// one from a random seed of the process on the first call
+[[nodiscard]] wyrand &threadRandom() noexcept;
 
 } // namespace hse
 
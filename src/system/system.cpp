@@ -1,14 +1,26 @@
 #include "system.h"
 
 #ifdef HAVE_MMAP
+#include <fcntl.h>
 #include <sys/mman.h>
+#endif
+
+#ifdef HAVE_NUMA
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef HAVE_MMAP
 #elif defined HAVE_VIRTUAL_ALLOC
 #include <memoryapi.h>
 #include <sysinfoapi.h>
 #define _SC_PAGE_SIZE 0
 #endif
 
+#include <array>
 #include <cerrno>
+#include <climits>
 #include <cstddef>
 #include <cstdint>
 #include <sys/types.h>
@@ -65,6 +77,81 @@ std::uintptr_t mmap(std::size_t size) {
     return reinterpret_cast<std::uintptr_t>(ptr);
 }
 
+std::uintptr_t reserve(std::size_t size) {
+    void *ptr =
+#ifdef HAVE_MMAP
+        // NOLINTNEXTLINE(hicpp-signed-bitwise)
+        ::mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)
+#elif defined HAVE_VIRTUAL_ALLOC
+        ::VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS)
+#endif
+    ;
+    if (ptr ==
+#ifdef HAVE_MMAP
+            reinterpret_cast<void *>(-1)
+#elif defined HAVE_VIRTUAL_ALLOC
+            nullptr
+#endif
+        ) {
+        throw std::system_error(errno, std::system_category(),
+#ifdef HAVE_MMAP
+            "mmap"
+#elif defined HAVE_VIRTUAL_ALLOC
+            "VirtualAlloc"
+#endif
+        );
+    }
+    return reinterpret_cast<std::uintptr_t>(ptr);
+}
+
+void commit(std::uintptr_t addr, std::size_t len) {
+    if (
+#ifdef HAVE_MMAP
+    // NOLINTNEXTLINE(hicpp-signed-bitwise)
+    ::mprotect(reinterpret_cast<void *>(addr), len, PROT_READ | PROT_WRITE) == -1
+#elif defined HAVE_VIRTUAL_ALLOC
+    ::VirtualAlloc(reinterpret_cast<void *>(addr), len, MEM_COMMIT, PAGE_READWRITE) == nullptr
+#endif
+    ) {
+        throw std::system_error(errno, std::system_category(),
+#ifdef HAVE_MMAP
+            "mprotect"
+#elif defined HAVE_VIRTUAL_ALLOC
+            "VirtualAlloc"
+#endif
+        );
+    }
+}
+
+std::uintptr_t mapFile([[maybe_unused]] const char *path, [[maybe_unused]] std::size_t size) noexcept {
+#ifdef HAVE_MMAP
+    // NOLINTNEXTLINE(hicpp-signed-bitwise, cppcoreguidelines-pro-type-vararg)
+    int fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return 0;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) == -1) {
+        auto err = errno;
+        ::close(fd);
+        errno = err;
+        return 0;
+    }
+
+    // NOLINTNEXTLINE(hicpp-signed-bitwise)
+    void *ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    auto err = errno;
+    // mapping keeps the file open
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+        errno = err;
+        return 0;
+    }
+    return reinterpret_cast<std::uintptr_t>(ptr);
+#else
+    return 0;
+#endif
+}
+
 void munmap(std::uintptr_t addr, std::size_t len) {
     if (
 #ifdef HAVE_MMAP
@@ -83,6 +170,97 @@ void munmap(std::uintptr_t addr, std::size_t len) {
     }
 }
 
+std::uintptr_t mremap([[maybe_unused]] std::uintptr_t addr,
+                      [[maybe_unused]] std::size_t oldSize,
+                      [[maybe_unused]] std::size_t newSize) {
+#ifdef HAVE_MREMAP
+    void *ptr = ::mremap(reinterpret_cast<void *>(addr), oldSize, newSize, MREMAP_MAYMOVE);
+    if (ptr == MAP_FAILED) {
+        throw std::system_error(errno, std::system_category(), "mremap");
+    }
+    return reinterpret_cast<std::uintptr_t>(ptr);
+#else
+    return 0;
+#endif
+}
+
+bool purge([[maybe_unused]] std::uintptr_t addr, [[maybe_unused]] std::size_t len) {
+#ifdef HAVE_MADV_DONTNEED
+    if (::madvise(reinterpret_cast<void *>(addr), len, MADV_DONTNEED) == -1) {
+        throw std::system_error(errno, std::system_category(), "madvise");
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool adviseHugePages([[maybe_unused]] std::uintptr_t addr, [[maybe_unused]] std::size_t len) noexcept {
+#ifdef HAVE_MADV_HUGEPAGE
+    // advice fails if transparent huge pages are disabled in the kernel,
+    // which is not an error for the caller
+    return ::madvise(reinterpret_cast<void *>(addr), len, MADV_HUGEPAGE) == 0;
+#else
+    return false;
+#endif
+}
+
+std::size_t nodeCount() noexcept {
+#ifdef HAVE_NUMA
+    // file holds a range of node numbers like "0-3" or a single "0"
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+    int fd = ::open("/sys/devices/system/node/possible", O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 1;
+    }
+    std::array<char, 64> buf{};
+    auto len = ::read(fd, buf.data(), buf.size() - 1);
+    ::close(fd);
+
+    // the last number in the file is the largest node
+    std::size_t last = 0;
+    for (decltype(len) i = 0; i < len; ++i) {
+        if (buf[i] >= '0' && buf[i] <= '9') {
+            last = last * 10 + static_cast<std::size_t>(buf[i] - '0');
+        } else if (buf[i] != '\n') {
+            last = 0;
+        }
+    }
+    return last + 1;
+#else
+    return 1;
+#endif
+}
+
+std::size_t currentNode() noexcept {
+#ifdef HAVE_NUMA
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    if (::getcpu(&cpu, &node) == -1) {
+        return 0;
+    }
+    return node;
+#else
+    return 0;
+#endif
+}
+
+bool bindNode([[maybe_unused]] std::uintptr_t addr, [[maybe_unused]] std::size_t len,
+    [[maybe_unused]] std::size_t node) noexcept {
+#ifdef HAVE_NUMA
+    constexpr std::size_t MASK_BITS = sizeof(unsigned long) * CHAR_BIT;
+    if (node >= MASK_BITS) {
+        return false;
+    }
+    unsigned long mask = 1UL << node;
+    // preferred policy falls back to other nodes instead of failing
+    // allocation when the node runs out of memory
+    return ::syscall(SYS_mbind, addr, len, MPOL_PREFERRED, &mask, MASK_BITS + 1, 0) == 0;
+#else
+    return false;
+#endif
+}
+
 extern std::size_t PAGE_SIZE() {
     static std::size_t PAGE_SIZE = system::sysconf(_SC_PAGE_SIZE);
     return PAGE_SIZE;
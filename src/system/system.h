@@ -13,9 +13,53 @@ extern std::size_t PAGE_SIZE();
 // for READ and WRITE permissions capable of holding size bytes
 std::uintptr_t mmap(std::size_t size);
 
+// reserve reserves integer number of PRIVATE ANONYMOUS pages of address
+// space capable of holding size bytes without access to them,
+// so that they do not consume memory until committed
+std::uintptr_t reserve(std::size_t size);
+
+// commit makes pages in indicated range of reserved address space
+// available for READ and WRITE
+void commit(std::uintptr_t addr, std::size_t len);
+
+// mapFile maps file at given path, which is created or resized to given size
+// if needed, for READ and WRITE shared with other processes.
+// It returns zero and keeps errno if the file can not be mapped or it is
+// not supported. It never throws, since exceptions allocate memory
+// and it is called from allocation functions
+std::uintptr_t mapFile(const char *path, std::size_t size) noexcept;
+
 // munmap removes mappings for all pages containing the part of indicated range
 void munmap(std::uintptr_t addr, std::size_t len);
 
+// mremap resizes mapping of indicated range to new size, growing it
+// in place if following addresses are free or moving its pages otherwise.
+// It returns new address of the range or zero if it is not supported
+std::uintptr_t mremap(std::uintptr_t addr, std::size_t oldSize, std::size_t newSize);
+
+// purge releases physical memory of pages in indicated range keeping
+// them mapped, so that they are filled with zeros on the next access.
+// It returns false if it is not supported and nothing was done
+bool purge(std::uintptr_t addr, std::size_t len);
+
+// adviseHugePages advises the kernel to back pages in indicated range
+// with transparent huge pages.
+// It returns false if it is not supported and nothing was done
+bool adviseHugePages(std::uintptr_t addr, std::size_t len) noexcept;
+
+// nodeCount returns a number of NUMA nodes of the machine
+// or one if it is not supported
+std::size_t nodeCount() noexcept;
+
+// currentNode returns NUMA node of the CPU current thread runs on
+// or zero if it is not supported
+std::size_t currentNode() noexcept;
+
+// bindNode sets memory policy of pages in indicated range, so that
+// they are backed by physical memory of given NUMA node if it is available.
+// It returns false if it is not supported and nothing was done
+bool bindNode(std::uintptr_t addr, std::size_t len, std::size_t node) noexcept;
+
 } // namespace hse::system
 
 #endif // SYSTEM_H
@@ -0,0 +1,102 @@
+#include "trace.h"
+#include "system/system.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace hse::trace {
+
+namespace {
+
+// State is a state of mapping of trace file
+enum class State : std::uint8_t {
+    UNMAPPED,
+    MAPPING,
+    MAPPED,
+    FAILED,
+};
+
+std::atomic<State> state{State::UNMAPPED};
+Header *header = nullptr;
+
+std::atomic<std::uint16_t> threads{0};
+constinit thread_local std::uint16_t thread = 0;
+
+// recording is true while current thread records a call, so that
+// allocations made meanwhile, e.g. by mapping of the file, are not recorded
+// and do not wait for the mapping they are part of
+constinit thread_local bool recording = false;
+
+// Guard sets recording for its lifetime
+struct Guard {
+    Guard() noexcept { recording = true; }
+    Guard(const Guard &) = delete;
+    Guard &operator=(const Guard &) = delete;
+    ~Guard() { recording = false; }
+};
+
+// map maps trace file on the first call and returns its header
+// or nullptr if it can not be mapped
+Header *map() noexcept {
+    auto current = state.load(std::memory_order_acquire);
+    if (current == State::UNMAPPED && state.compare_exchange_strong(current, State::MAPPING)) {
+        const char *path = std::getenv("HSE_MALLOC_TRACE_FILE");
+        auto addr = system::mapFile(path != nullptr ? path : DEFAULT_PATH, FILE_SIZE);
+        if (addr == 0) {
+            state.store(State::FAILED, std::memory_order_release);
+            return nullptr;
+        }
+        header = new (reinterpret_cast<void *>(addr)) Header{Header::MAGIC, Header::CAPACITY, {0}};
+        state.store(State::MAPPED, std::memory_order_release);
+    }
+
+    while ((current = state.load(std::memory_order_acquire)) == State::MAPPING) {
+        // wait for another thread mapping the file
+    }
+    return current == State::MAPPED ? header : nullptr;
+}
+
+} // namespace
+
+Record *reserve() noexcept {
+    if (recording) {
+        return nullptr;
+    }
+    Guard guard;
+
+    auto *h = map();
+    if (h == nullptr) {
+        return nullptr;
+    }
+    if (thread == 0) {
+        thread = threads.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    auto i = h->head.fetch_add(1, std::memory_order_relaxed) % h->capacity;
+    auto *record = reinterpret_cast<Record *>(h + 1) + i;
+    record->timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    record->thread = thread;
+    return record;
+}
+
+void fill(Record *record, Op op, std::uintptr_t ptr, std::uintptr_t result, std::size_t size, std::size_t alignment) noexcept {
+    if (record == nullptr) {
+        return;
+    }
+    record->ptr = ptr;
+    record->result = result;
+    record->size = size;
+    record->alignment = static_cast<std::uint32_t>(alignment);
+    record->op = op;
+}
+
+void record(Op op, std::uintptr_t ptr, std::uintptr_t result, std::size_t size, std::size_t alignment) noexcept {
+    fill(reserve(), op, ptr, result, size, alignment);
+}
+
+} // namespace hse::trace
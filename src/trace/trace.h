@@ -0,0 +1,79 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace hse::trace {
+
+// Op is a traced operation. REALLOC is recorded before the old block
+// is released, and if the block is moved, MOVED of the same thread
+// is recorded after the new one is allocated, so that both take their
+// places among calls of other threads reusing the same addresses
+enum class Op : std::uint8_t {
+    MALLOC,
+    CALLOC,
+    REALLOC,
+    ALIGNED_ALLOC,
+    FREE,
+    MOVED,
+};
+
+// Record describes a single call. Pointers identify allocations:
+// ptr is the argument of free and realloc and result is the returned one
+struct Record {
+    // timestamp is a time of the call in nanoseconds of steady clock
+    std::uint64_t timestamp;
+    std::uint64_t ptr;
+    std::uint64_t result;
+    std::uint64_t size;
+    std::uint32_t alignment;
+
+    // thread is a number of calling thread in order of their first calls
+    std::uint16_t thread;
+    Op op;
+};
+
+// Header is placed at the beginning of trace file and followed
+// by a ring of CAPACITY records
+struct Header {
+    static constexpr std::uint64_t MAGIC = 0x4543415254455348ULL; // "HSETRACE" in little endian
+
+    // CAPACITY is a number of records in the ring
+    static constexpr std::uint64_t CAPACITY = 1ULL << 20U;
+
+    std::uint64_t magic;
+    std::uint64_t capacity;
+
+    // head is a total number of records ever written, so that record
+    // with number i is stored at i % capacity and only the last capacity
+    // of them are kept
+    std::atomic<std::uint64_t> head;
+};
+
+// FILE_SIZE is a size of trace file
+constexpr std::size_t FILE_SIZE = sizeof(Header) + Header::CAPACITY * sizeof(Record);
+
+// DEFAULT_PATH is a path of trace file if HSE_MALLOC_TRACE_FILE is not set
+constexpr const char *DEFAULT_PATH = "hse_malloc.trace";
+
+// reserve takes the next record of the trace file, which is mapped
+// on the first call, and stores time and thread of a call to it.
+// The record should be filled by fill after the call, which lets calls
+// releasing memory take their place in order of calls before another
+// thread can allocate the same address. It never allocates memory,
+// so it can be called from any allocation function. It returns nullptr
+// if the file can not be mapped, in which case calls are dropped.
+[[nodiscard]] Record *reserve() noexcept;
+
+// fill completes record taken by reserve with given call,
+// doing nothing for nullptr
+void fill(Record *record, Op op, std::uintptr_t ptr, std::uintptr_t result, std::size_t size, std::size_t alignment) noexcept;
+
+// record appends record of given call to the trace file
+void record(Op op, std::uintptr_t ptr, std::uintptr_t result, std::size_t size, std::size_t alignment) noexcept;
+
+} // namespace hse::trace
+
+#endif // TRACE_H
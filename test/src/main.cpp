@@ -1,11 +1,39 @@
+#include <config/config.h>
 #include <malloc.h>
+#include <math/math.h>
+#include <memory/allocator.h>
+#include <memory/arenas.h>
+#include <memory/chunk_cache.h>
+#include <memory/large_allocator.h>
+#include <memory/memory_control_block.h>
+#include <memory/memory_control_block_list.h>
+#include <memory/page_map.h>
+#include <memory/page_source.h>
+#include <memory/quick_cache.h>
+#include <memory/size_class.h>
+#include <memory/slab_allocator.h>
+#include <memory/span.h>
+#include <memory/thread_cache.h>
+#include <random/random.h>
+#include <system/system.h>
 
 #define CATCH_CONFIG_MAIN
 #include "catch2/catch.hpp"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <limits>
 #include <span>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 namespace {
     // all constans are not aligned
@@ -65,6 +93,23 @@ TEST_CASE("calloc: zero arguments", "[calloc]") {
     REQUIRE(hse::calloc(0, 0) == nullptr);
 }
 
+TEST_CASE("calloc: overflow", "[calloc]") {
+    REQUIRE(hse::calloc(SIZE_MAX / 2, 3) == nullptr);
+    REQUIRE(hse::calloc(3, SIZE_MAX / 2) == nullptr);
+}
+
+TEST_CASE("calloc: memory is zeroed after reuse", "[malloc][calloc][free]") {
+    for (auto size : {SMALL_NUMBER, LESS_THAN_PAGE, MEDIUM_NUMBER, BIG_NUMBER}) {
+        auto *ptr = reinterpret_cast<std::uint8_t *>(hse::malloc(size));
+        testArray(std::span{ptr, size});
+        hse::free(ptr);
+
+        ptr = reinterpret_cast<std::uint8_t *>(hse::calloc(size, sizeof(std::uint8_t)));
+        REQUIRE(std::all_of(ptr, ptr + size, [](auto i) { return i == 0; }));
+        hse::free(ptr);
+    }
+}
+
 TEST_CASE("calloc: array of small objects", "[calloc][free]") {
     auto *ptr = reinterpret_cast<std::uint8_t *>(hse::calloc(MEDIUM_NUMBER, sizeof(std::uint8_t)));
     testArray(std::span{ptr, MEDIUM_NUMBER});
@@ -113,6 +158,21 @@ TEST_CASE("realloc: smaller after big malloc", "[malloc][realloc][free]" ) {
     hse::free(ptr);
 }
 
+TEST_CASE("realloc: growing and shrinking big allocation", "[malloc][realloc][free]" ) {
+    auto *ptr = reinterpret_cast<std::uint8_t *>(hse::malloc(BIG_NUMBER * sizeof(std::uint8_t)));
+    testArray(std::span{ptr, BIG_NUMBER});
+    for (std::size_t size = 2 * BIG_NUMBER; size <= 8 * BIG_NUMBER; size *= 2) {
+        ptr = reinterpret_cast<std::uint8_t *>(hse::realloc(ptr, size));
+        REQUIRE(ptr[0] == '0');
+        REQUIRE(ptr[BIG_NUMBER - 1] == '0');
+        ptr[size - 1] = '1';
+    }
+    ptr = reinterpret_cast<std::uint8_t *>(hse::realloc(ptr, BIG_NUMBER));
+    REQUIRE(ptr[0] == '0');
+    REQUIRE(ptr[BIG_NUMBER - 1] == '0');
+    hse::free(ptr);
+}
+
 TEST_CASE("realloc: smaller than page after malloc smaller than page", "[malloc][realloc][free]" ) {
     auto *ptr = reinterpret_cast<std::uint8_t *>(hse::malloc(LESS_THAN_PAGE * sizeof(std::uint8_t)));
     testArray(std::span{ptr, LESS_THAN_PAGE});
@@ -258,3 +318,874 @@ TEST_CASE("aligned_alloc: small alignment, "
     hse::free(ptr5);
 }
 
+
+TEST_CASE("malloc: concurrent small allocations", "[malloc][free][thread]") {
+    constexpr std::size_t THREADS    = 8;
+    constexpr std::size_t ITERATIONS = 1UL << 12U;
+
+    std::vector<std::thread> threads;
+    std::atomic<bool> failed = false;
+    for (std::size_t t = 0; t < THREADS; ++t) {
+        threads.emplace_back([t, &failed] {
+            std::array<std::uint8_t *, SMALL_NUMBER> ptrs{};
+            for (std::size_t i = 0; i < ITERATIONS; ++i) {
+                auto &ptr = ptrs[i % ptrs.size()];
+                if (ptr != nullptr) {
+                    if (ptr[0] != static_cast<std::uint8_t>(t) || ptr[SMALL_NUMBER - 1] != static_cast<std::uint8_t>(t)) {
+                        failed = true;
+                    }
+                    hse::free(ptr);
+                }
+                ptr = reinterpret_cast<std::uint8_t *>(hse::malloc(SMALL_NUMBER + i % LESS_THAN_PAGE));
+                ptr[0] = ptr[SMALL_NUMBER - 1] = static_cast<std::uint8_t>(t);
+            }
+            for (auto *ptr : ptrs) {
+                hse::free(ptr);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    REQUIRE_FALSE(failed);
+}
+
+TEST_CASE("realloc: concurrent reallocations", "[malloc][realloc][free][thread]") {
+    constexpr std::size_t THREADS    = 4;
+    constexpr std::size_t ITERATIONS = 1UL << 10U;
+    const std::array<std::size_t, 3> SIZES{SMALL_NUMBER, LESS_THAN_PAGE, hse::memory::LargeAllocator::DEFAULT_THRESHOLD};
+
+    std::vector<std::thread> threads;
+    std::atomic<bool> failed = false;
+    for (std::size_t t = 0; t < THREADS; ++t) {
+        threads.emplace_back([t, &failed, &SIZES] {
+            std::array<std::uint8_t *, SMALL_NUMBER> ptrs{};
+            for (std::size_t i = 0; i < ITERATIONS; ++i) {
+                // blocks move between slabs, arenas and mappings,
+                // so that addresses released by one thread are reused by others
+                auto &ptr = ptrs[i % ptrs.size()];
+                if (ptr != nullptr && ptr[0] != static_cast<std::uint8_t>(t)) {
+                    failed = true;
+                }
+                auto *moved = reinterpret_cast<std::uint8_t *>(hse::realloc(ptr, SIZES[(i / ptrs.size() + t) % SIZES.size()]));
+                if (moved == nullptr) {
+                    failed = true;
+                    continue;
+                }
+                ptr = moved;
+                ptr[0] = static_cast<std::uint8_t>(t);
+            }
+            for (auto *ptr : ptrs) {
+                hse::free(ptr);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    REQUIRE_FALSE(failed);
+}
+
+TEST_CASE("malloc: free from another thread", "[malloc][free][thread]") {
+    std::array<std::uint8_t *, SMALL_NUMBER> ptrs{};
+    std::thread([&ptrs] {
+        for (auto &ptr : ptrs) {
+            ptr = reinterpret_cast<std::uint8_t *>(hse::malloc(SMALL_NUMBER));
+            testArray(std::span{ptr, SMALL_NUMBER});
+        }
+    }).join();
+    std::thread([&ptrs] {
+        for (auto *ptr : ptrs) {
+            hse::free(ptr);
+        }
+    }).join();
+}
+
+TEST_CASE("malloc: max_align_t alignment", "[malloc][free]") {
+    for (std::size_t size = 1; size <= LESS_THAN_PAGE; size += SMALL_NUMBER) {
+        auto *ptr = hse::malloc(size);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % alignof(std::max_align_t) == 0);
+        hse::free(ptr);
+    }
+}
+
+TEST_CASE("malloc: reuse of fragmented free blocks", "[malloc][free]") {
+    constexpr std::size_t COUNT = 1UL << 12U;
+
+    std::vector<std::uint8_t *> ptrs(COUNT);
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        ptrs[i] = reinterpret_cast<std::uint8_t *>(hse::malloc(SMALL_NUMBER + i * SMALL_NUMBER % MEDIUM_NUMBER));
+        ptrs[i][0] = static_cast<std::uint8_t>(i);
+    }
+    // free every other block, so that free blocks can not be merged
+    for (std::size_t i = 0; i < COUNT; i += 2) {
+        hse::free(ptrs[i]);
+    }
+    for (std::size_t i = 0; i < COUNT; i += 2) {
+        ptrs[i] = reinterpret_cast<std::uint8_t *>(hse::malloc(SMALL_NUMBER + (COUNT - i) * SMALL_NUMBER % MEDIUM_NUMBER));
+        ptrs[i][0] = static_cast<std::uint8_t>(i);
+    }
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        REQUIRE(ptrs[i][0] == static_cast<std::uint8_t>(i));
+        hse::free(ptrs[i]);
+    }
+}
+
+TEST_CASE("malloc: small sizes are served from slabs", "[malloc][free][slab]") {
+    for (std::size_t size = 1; size <= hse::memory::SMALL_SIZE_MAX; size += SMALL_NUMBER) {
+        auto *ptr = reinterpret_cast<std::uint8_t *>(hse::malloc(size));
+        auto *span = hse::memory::Span::fromPtr(reinterpret_cast<std::uintptr_t>(ptr));
+        REQUIRE(span != nullptr);
+        REQUIRE(span->slotSize() >= size);
+        REQUIRE(span->slotSize() < size + hse::memory::SMALL_SIZE_MAX / 4);
+        hse::free(ptr);
+    }
+    REQUIRE(hse::memory::Span::fromPtr(reinterpret_cast<std::uintptr_t>(&SMALL_NUMBER)) == nullptr);
+}
+
+TEST_CASE("operator_new and operator_delete", "[new][free][slab]") {
+    auto mode = hse::randomization();
+    hse::setRandomization(hse::Randomization::NONE);
+
+    // zero size gives distinct pointers
+    auto *first = hse::operator_new(0);
+    auto *second = hse::operator_new(0);
+    REQUIRE(first != nullptr);
+    REQUIRE(first != second);
+    hse::operator_delete(first, 0);
+    hse::operator_delete(second, 0);
+    hse::operator_delete(nullptr, SMALL_NUMBER);
+
+    for (auto size : {std::size_t{1}, SMALL_NUMBER, hse::memory::SMALL_SIZE_MAX, LESS_THAN_PAGE, MEDIUM_NUMBER, BIG_NUMBER}) {
+        auto *ptr = hse::operator_new(size);
+        REQUIRE(hse::malloc_usable_size(ptr) >= size);
+        testArray(std::span{reinterpret_cast<std::uint8_t *>(ptr), size});
+        hse::operator_delete(ptr, size);
+
+        // slot deleted with its size is taken back from the thread cache
+        if (size <= hse::memory::SMALL_SIZE_MAX) {
+            auto *again = hse::operator_new(size);
+            REQUIRE(again == ptr);
+            hse::operator_delete(again, size);
+        }
+    }
+
+    // memory of operator_new can be freed by free too
+    auto *ptr = hse::operator_new(SMALL_NUMBER);
+    hse::free(ptr);
+    hse::setRandomization(mode);
+}
+
+TEST_CASE("posix_memalign, memalign, valloc and pvalloc", "[aligned_alloc][free]") {
+    const std::size_t PAGE = hse::system::PAGE_SIZE();
+
+    void *ptr = nullptr;
+    REQUIRE(hse::posix_memalign(&ptr, 3 * sizeof(void *), SMALL_NUMBER) == EINVAL);
+    REQUIRE(hse::posix_memalign(&ptr, sizeof(void *) / 2, SMALL_NUMBER) == EINVAL);
+    REQUIRE(hse::posix_memalign(&ptr, 64, 0) == 0);
+    REQUIRE(ptr == nullptr);
+
+    // size does not have to be a multiple of alignment
+    for (std::size_t alignment : {std::size_t{8}, std::size_t{64}, PAGE, PAGE * 16}) {
+        for (auto size : {SMALL_NUMBER, LESS_THAN_PAGE, MEDIUM_NUMBER}) {
+            REQUIRE(hse::posix_memalign(&ptr, alignment, size) == 0);
+            REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0);
+            testArray(std::span{reinterpret_cast<std::uint8_t *>(ptr), size});
+            hse::free(ptr);
+
+            ptr = hse::memalign(alignment, size);
+            REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0);
+            testArray(std::span{reinterpret_cast<std::uint8_t *>(ptr), size});
+            hse::free_aligned_sized(ptr, alignment, size);
+        }
+    }
+
+    // alignment of memalign is rounded up to a power of two
+    ptr = hse::memalign(48, SMALL_NUMBER);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % 64 == 0);
+    hse::free(ptr);
+
+    ptr = hse::valloc(SMALL_NUMBER);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % PAGE == 0);
+    hse::free(ptr);
+
+    // pvalloc rounds size up to whole pages
+    for (auto size : {std::size_t{0}, SMALL_NUMBER, PAGE + 1}) {
+        ptr = hse::pvalloc(size);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % PAGE == 0);
+        REQUIRE(hse::malloc_usable_size(ptr) >= std::max(hse::math::roundUp(size, PAGE), PAGE));
+        hse::free(ptr);
+    }
+    REQUIRE(hse::pvalloc(std::numeric_limits<std::size_t>::max()) == nullptr);
+}
+
+TEST_CASE("aligned_alloc: small sizes are served from aligned slots", "[aligned_alloc][free][slab]") {
+    for (std::size_t alignment = 32; alignment <= hse::memory::SMALL_SIZE_MAX; alignment *= 2) {
+        for (auto size = alignment; size <= hse::memory::SMALL_SIZE_MAX; size += alignment) {
+            auto *ptr = hse::aligned_alloc(alignment, size);
+            REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0);
+            auto *span = hse::memory::Span::fromPtr(reinterpret_cast<std::uintptr_t>(ptr));
+            REQUIRE(span != nullptr);
+            REQUIRE(span->slotSize() >= size);
+            REQUIRE(span->slotSize() % alignment == 0);
+            testArray(std::span{reinterpret_cast<std::uint8_t *>(ptr), size});
+            if (size % (2 * alignment) == 0) {
+                hse::free_aligned_sized(ptr, alignment, size);
+            } else {
+                hse::free(ptr);
+            }
+        }
+    }
+}
+
+TEST_CASE("realloc: between slab and block", "[malloc][realloc][free][slab]") {
+    auto *ptr = reinterpret_cast<std::uint8_t *>(hse::malloc(SMALL_NUMBER));
+    testArray(std::span{ptr, SMALL_NUMBER});
+    ptr = reinterpret_cast<std::uint8_t *>(hse::realloc(ptr, LESS_THAN_PAGE));
+    REQUIRE(ptr[SMALL_NUMBER - 1] == '0');
+    testArray(std::span{ptr, LESS_THAN_PAGE});
+    ptr = reinterpret_cast<std::uint8_t *>(hse::realloc(ptr, SMALL_NUMBER / 2));
+    REQUIRE(ptr[SMALL_NUMBER / 2 - 1] == '0');
+    hse::free(ptr);
+}
+
+TEST_CASE("malloc: large sizes are mapped separately", "[malloc][realloc][aligned_alloc][free][large]") {
+    const std::size_t SIZE = hse::memory::LargeAllocator::DEFAULT_THRESHOLD;
+
+    auto *ptr = reinterpret_cast<std::uint8_t *>(hse::malloc(SIZE));
+    REQUIRE(ptr != nullptr);
+    auto *span = hse::memory::Span::fromPtr(reinterpret_cast<std::uintptr_t>(ptr));
+    REQUIRE(span != nullptr);
+    REQUIRE(span->large());
+
+    testArray(std::span{ptr, SIZE});
+    ptr = reinterpret_cast<std::uint8_t *>(hse::realloc(ptr, SIZE * 4));
+    REQUIRE(ptr[SIZE - 1] == '0');
+    REQUIRE(hse::memory::Span::fromPtr(reinterpret_cast<std::uintptr_t>(ptr))->large());
+
+    // shrinking below the threshold moves data back to blocks
+    ptr = reinterpret_cast<std::uint8_t *>(hse::realloc(ptr, SIZE / 4));
+    REQUIRE(ptr[SIZE / 4 - 1] == '0');
+    REQUIRE(hse::memory::Span::fromPtr(reinterpret_cast<std::uintptr_t>(ptr)) == nullptr);
+    hse::free(ptr);
+
+    const std::size_t ALIGNMENT = 1UL << 16U;
+    ptr = reinterpret_cast<std::uint8_t *>(hse::aligned_alloc(ALIGNMENT, SIZE));
+    REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % ALIGNMENT == 0);
+    REQUIRE(hse::memory::Span::fromPtr(reinterpret_cast<std::uintptr_t>(ptr))->large());
+    testArray(std::span{ptr, SIZE});
+    hse::free(ptr);
+}
+
+TEST_CASE("malloc_usable_size and free_sized", "[malloc][realloc][aligned_alloc][free]") {
+    for (auto size : {SMALL_NUMBER, LESS_THAN_PAGE, MEDIUM_NUMBER, BIG_NUMBER}) {
+        auto *ptr = reinterpret_cast<std::uint8_t *>(hse::malloc(size));
+        auto usable = hse::malloc_usable_size(ptr);
+        REQUIRE(usable >= size);
+        testArray(std::span{ptr, std::min(usable, LESS_THAN_PAGE * 2)});
+        ptr[usable - 1] = '1';
+        hse::free_sized(ptr, size);
+    }
+
+    // small memory is a slot whichever way it was allocated
+    auto *ptr = hse::realloc(hse::malloc(MEDIUM_NUMBER), SMALL_NUMBER);
+    REQUIRE(hse::memory::Span::fromPtr(reinterpret_cast<std::uintptr_t>(ptr)) != nullptr);
+    hse::free_sized(ptr, SMALL_NUMBER);
+
+    const std::size_t ALIGNMENT = 64;
+    ptr = hse::aligned_alloc(ALIGNMENT, ALIGNMENT);
+    REQUIRE(hse::malloc_usable_size(ptr) >= ALIGNMENT);
+    hse::free_aligned_sized(ptr, ALIGNMENT, ALIGNMENT);
+    REQUIRE(hse::malloc_usable_size(nullptr) == 0);
+}
+
+TEST_CASE("malloc_batch and free_batch", "[malloc][free][batch]") {
+    constexpr std::size_t COUNT = 100;
+    auto mode = hse::randomization();
+    hse::setRandomization(hse::Randomization::NONE);
+
+    // slots freed remotely by previous tests are drained by an allocation
+    void *drain = nullptr;
+    hse::free_batch(&drain, hse::malloc_batch(SMALL_NUMBER, 1, &drain));
+    auto before = hse::malloc_stats_get();
+
+    for (auto size : {SMALL_NUMBER, LESS_THAN_PAGE, BIG_NUMBER}) {
+        std::array<void *, COUNT> ptrs{};
+        REQUIRE(hse::malloc_batch(size, COUNT, ptrs.data()) == COUNT);
+        for (auto *ptr : ptrs) {
+            REQUIRE(ptr != nullptr);
+            REQUIRE(hse::malloc_usable_size(ptr) >= size);
+            std::fill_n(reinterpret_cast<std::uint8_t *>(ptr), size, '0');
+        }
+        if (size == LESS_THAN_PAGE) {
+            // blocks are carved out of a single chunk one after another
+            auto stride = hse::math::roundUp(size, hse::memory::MemoryControlBlock::ALIGNMENT)
+                + sizeof(hse::memory::MemoryControlBlock);
+            REQUIRE(reinterpret_cast<std::uintptr_t>(ptrs[1]) - reinterpret_cast<std::uintptr_t>(ptrs[0]) == stride);
+        }
+
+        // nullptr is skipped
+        hse::free_batch(ptrs.data(), 1);
+        ptrs[0] = nullptr;
+        hse::free_batch(ptrs.data(), COUNT);
+    }
+
+    REQUIRE(hse::malloc_batch(SMALL_NUMBER, 0, nullptr) == 0);
+    REQUIRE(hse::malloc_stats_get().allocated == before.allocated);
+    hse::setRandomization(mode);
+}
+
+TEST_CASE("uniform_int_distribution: bounds are inclusive and draws are uniform", "[random]") {
+    const std::size_t MIN = 3;
+    const std::size_t MAX = 5;
+    const std::size_t DRAWS = 30000;
+    hse::wyrand prng{42};
+    hse::uniform_int_distribution<std::size_t> distribution(MIN, MAX);
+
+    std::array<std::size_t, MAX - MIN + 1> counts{};
+    for (std::size_t i = 0; i < DRAWS; ++i) {
+        auto value = distribution(prng);
+        REQUIRE(value >= MIN);
+        REQUIRE(value <= MAX);
+        ++counts[value - MIN];
+    }
+    for (auto count : counts) {
+        REQUIRE(count > DRAWS / counts.size() * 9 / 10);
+        REQUIRE(count < DRAWS / counts.size() * 11 / 10);
+    }
+
+    // range of a single value and the whole range
+    REQUIRE(hse::uniform_int_distribution<std::size_t>(MAX, MAX)(prng) == MAX);
+    hse::uniform_int_distribution<std::uint64_t> whole;
+    REQUIRE(whole(prng) != whole(prng));
+}
+
+namespace {
+
+// LAYOUT_BLOCKS is a number of blocks whose layout is compared between runs
+constexpr std::size_t LAYOUT_BLOCKS = 16;
+
+// earlyBlock is allocated during static initialization of tests, which
+// precedes one of the allocator, as allocations of other libraries do
+void *const earlyBlock = hse::malloc(LESS_THAN_PAGE);
+
+// layoutOfNewProcess runs the hidden layout test in a new process
+// and returns its output
+std::string layoutOfNewProcess() {
+    std::array<int, 2> fds{};
+    REQUIRE(::pipe(fds.data()) == 0);
+    auto pid = ::fork();
+    REQUIRE(pid != -1);
+    if (pid == 0) {
+        ::dup2(fds[1], STDOUT_FILENO);
+        ::close(fds[0]);
+        ::execl("/proc/self/exe", "/proc/self/exe", "random: layout of main thread", nullptr);
+        ::_exit(1);
+    }
+
+    ::close(fds[1]);
+    std::string output;
+    std::array<char, 256> buffer{};
+    for (ssize_t n = 0; (n = ::read(fds[0], buffer.data(), buffer.size())) > 0;) {
+        output.append(buffer.data(), static_cast<std::size_t>(n));
+    }
+    ::close(fds[0]);
+    int status = 0;
+    REQUIRE(::waitpid(pid, &status, 0) == pid);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+    return output;
+}
+
+} // namespace
+
+TEST_CASE("random: layout of main thread", "[.][layout]") {
+    hse::free(earlyBlock);
+
+    // offsets from the first block do not depend on randomized base addresses
+    // of mappings, so they show only randomization of the allocator
+    std::array<std::uintptr_t, LAYOUT_BLOCKS> blocks{};
+    std::array<std::uintptr_t, LAYOUT_BLOCKS> slots{};
+    for (std::size_t i = 0; i < LAYOUT_BLOCKS; ++i) {
+        blocks[i] = reinterpret_cast<std::uintptr_t>(hse::malloc(LESS_THAN_PAGE));
+        slots[i] = reinterpret_cast<std::uintptr_t>(hse::malloc(SMALL_NUMBER));
+    }
+    for (std::size_t i = 1; i < LAYOUT_BLOCKS; ++i) {
+        std::printf("%td %td\n", static_cast<std::ptrdiff_t>(blocks[i] - blocks[0]),
+            static_cast<std::ptrdiff_t>(slots[i] - slots[0]));
+    }
+}
+
+TEST_CASE("random: main thread is seeded differently in every process", "[random]") {
+    if (hse::randomization() == hse::Randomization::NONE) {
+        return;
+    }
+    auto first = layoutOfNewProcess();
+    auto second = layoutOfNewProcess();
+    REQUIRE(first.find(" ") != std::string::npos);
+    REQUIRE(first != second);
+}
+
+TEST_CASE("config: parses HSE_MALLOC_CONF string", "[config]") {
+    auto conf = hse::config::parse(
+        "random:slots,mmap_threshold:1m,retained_limit:64k,decay_ms:500,arenas:2,"
+        "deferred_coalescing:false,placement:best,huge_pages:true,stats_print:1");
+    REQUIRE(conf.random == hse::Randomization::SLOTS);
+    REQUIRE(conf.mmapThreshold == 1UL << 20U);
+    REQUIRE(conf.retainedLimit == 1UL << 16U);
+    REQUIRE(conf.decay == std::chrono::milliseconds(500));
+    REQUIRE(conf.arenas == 2);
+    REQUIRE(conf.deferredCoalescing == false);
+    REQUIRE(conf.placement == hse::memory::Placement::BEST);
+    REQUIRE(conf.hugePages == true);
+    REQUIRE(conf.statsPrint);
+
+    // invalid options are ignored
+    conf = hse::config::parse("random:maybe,,mmap_threshold:1x,arenas:0,unknown:1,decay_ms");
+    REQUIRE(!conf.random.has_value());
+    REQUIRE(!conf.mmapThreshold.has_value());
+    REQUIRE(!conf.arenas.has_value());
+    REQUIRE(!conf.decay.has_value());
+    REQUIRE(!conf.statsPrint);
+
+    // invalid values of repeated keys keep earlier valid ones
+    conf = hse::config::parse("placement:best,placement:bogus,stats_print:1,stats_print:maybe,arenas:2,arenas:0");
+    REQUIRE(conf.placement == hse::memory::Placement::BEST);
+    REQUIRE(conf.statsPrint);
+    REQUIRE(conf.arenas == 2);
+
+    conf = hse::config::parse(nullptr);
+    REQUIRE(!conf.hugePages.has_value());
+}
+
+TEST_CASE("allocator: freed blocks are cached before they are merged", "[allocator][quick_cache]") {
+    constexpr std::size_t SIZE = hse::memory::QuickCache::MAX_SIZE / 2 + 512;
+    constexpr std::size_t ALIGNMENT = hse::memory::MemoryControlBlock::ALIGNMENT;
+    auto mode = hse::randomization();
+    hse::setRandomization(hse::Randomization::NONE);
+
+    hse::memory::Allocator allocator;
+    std::array<std::uintptr_t, 2> ptrs{};
+    REQUIRE(allocator.allocBatch(SIZE, ptrs) == ptrs.size());
+    REQUIRE(ptrs[1] == ptrs[0] + SIZE + sizeof(hse::memory::MemoryControlBlock));
+
+    // cached block is counted as free and taken back as it is
+    auto freeBytes = allocator.freeStats().freeBytes;
+    allocator.free(ptrs[0]);
+    REQUIRE(allocator.freeStats().freeBytes == freeBytes + SIZE);
+    REQUIRE(allocator.alloc(SIZE, ALIGNMENT) == ptrs[0]);
+
+    // allocation of a size which is not cached merges cached blocks
+    allocator.free(ptrs[1]);
+    allocator.free(ptrs[0]);
+    auto merged = allocator.alloc(SIZE * 2, ALIGNMENT);
+    REQUIRE(merged == ptrs[0]);
+
+    // blocks are merged at once without the cache
+    allocator.setDeferredCoalescing(false);
+    allocator.free(merged);
+    REQUIRE(allocator.freeStats().freeBlocks == std::array<std::size_t, hse::memory::Stats::FREE_RANGES>{});
+    hse::setRandomization(mode);
+}
+
+TEST_CASE("allocator: freed blocks are shifted again with shift randomization", "[allocator][quick_cache][random]") {
+    constexpr std::size_t SIZE = hse::memory::QuickCache::MAX_SIZE / 2;
+    constexpr std::size_t ALIGNMENT = hse::memory::MemoryControlBlock::ALIGNMENT;
+    constexpr std::size_t ITERATIONS = 32;
+    auto mode = hse::randomization();
+    hse::setRandomization(hse::Randomization::SHIFT);
+
+    hse::memory::Allocator allocator;
+    auto ptr = allocator.alloc(SIZE, ALIGNMENT);
+    std::size_t reused = 0;
+    for (std::size_t i = 0; i < ITERATIONS; ++i) {
+        allocator.free(ptr);
+        auto next = allocator.alloc(SIZE, ALIGNMENT);
+        reused += next == ptr ? 1 : 0;
+        ptr = next;
+    }
+    allocator.free(ptr);
+    REQUIRE(reused < ITERATIONS / 2);
+    hse::setRandomization(mode);
+}
+
+TEST_CASE("allocator: aligned blocks are cached and taken back as they are", "[allocator][quick_cache]") {
+    constexpr std::size_t ALIGNMENT = 4096;
+    constexpr std::size_t SIZE = 2 * ALIGNMENT;
+    auto mode = hse::randomization();
+    hse::setRandomization(hse::Randomization::NONE);
+
+    hse::memory::Allocator allocator;
+    auto ptr = allocator.alloc(SIZE, ALIGNMENT);
+    REQUIRE(ptr % ALIGNMENT == 0);
+    auto unaligned = allocator.alloc(SIZE, hse::memory::MemoryControlBlock::ALIGNMENT);
+    REQUIRE(unaligned % ALIGNMENT != 0);
+    allocator.free(ptr);
+    allocator.free(unaligned);
+
+    // unaligned cached block of the same size is skipped
+    REQUIRE(allocator.alloc(SIZE, ALIGNMENT) == ptr);
+    REQUIRE(allocator.alloc(SIZE, hse::memory::MemoryControlBlock::ALIGNMENT) == unaligned);
+    hse::setRandomization(mode);
+}
+
+TEST_CASE("free block list: placement policies", "[mcb_list]") {
+    using hse::memory::MemoryControlBlock;
+    using hse::memory::Placement;
+    constexpr std::size_t STRIDE = 4096;
+    constexpr std::array<std::size_t, 3> SIZES{2400, 2096, 2512};
+
+    alignas(MemoryControlBlock) std::array<std::byte, STRIDE * SIZES.size()> buffer{};
+    auto block = [&buffer](std::size_t i) {
+        return reinterpret_cast<MemoryControlBlock *>(buffer.data() + i * STRIDE);
+    };
+    auto fits = [](const MemoryControlBlock *mcb) noexcept { return mcb->fits(2048); };
+
+    for (auto [placement, expected] : {std::pair{Placement::LIFO, 2}, {Placement::ADDRESS, 0}, {Placement::BEST, 1}}) {
+        hse::memory::FreeMemoryControlBlockList list;
+        list.setPlacement(placement);
+        for (std::size_t i = 0; i < SIZES.size(); ++i) {
+            block(i)->setSize(SIZES[i]);
+            list.insert(block(i));
+        }
+        REQUIRE(list.find(2048, fits) == block(expected));
+
+        // blocks inserted before are reordered
+        list.setPlacement(Placement::BEST);
+        REQUIRE(list.find(2048, fits) == block(1));
+        list.pop(block(1));
+        REQUIRE(list.find(2048, fits) == block(0));
+    }
+}
+
+TEST_CASE("free block list: medium blocks are found best-fit", "[mcb_list]") {
+    using hse::memory::MemoryControlBlock;
+    constexpr std::size_t STRIDE = 8192;
+    constexpr std::size_t COUNT = 256;
+
+    std::vector<MemoryControlBlock> buffer(STRIDE * COUNT / sizeof(MemoryControlBlock));
+    auto block = [&buffer](std::size_t i) {
+        return reinterpret_cast<MemoryControlBlock *>(reinterpret_cast<std::byte *>(buffer.data()) + i * STRIDE);
+    };
+
+    hse::memory::FreeMemoryControlBlockList list;
+    std::vector<MemoryControlBlock *> blocks;
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        // sizes from 3600 to 8000 with repetitions in shuffled order
+        block(i)->setSize(3600 + (i * 7919 % 276) * 16);
+        block(i)->setZeroed(i % 2 == 0);
+        list.insert(block(i));
+        blocks.push_back(block(i));
+    }
+
+    auto check = [&list, &blocks](std::size_t size) {
+        auto fits = [size](const MemoryControlBlock *mcb) noexcept { return mcb->fits(size); };
+        MemoryControlBlock *expected = nullptr;
+        for (auto *mcb : blocks) {
+            if (fits(mcb) && (expected == nullptr || mcb->size() < expected->size()
+                || (mcb->size() == expected->size() && mcb < expected))) {
+                expected = mcb;
+            }
+        }
+        REQUIRE(list.find(size, fits) == expected);
+    };
+
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        check(3600 + i * 17);
+        if (i % 3 == 0) {
+            // pop blocks from different places of the tree
+            auto *mcb = blocks[(i * 31) % blocks.size()];
+            list.pop(mcb);
+            std::erase(blocks, mcb);
+            if (mcb->zeroed()) {
+                const auto *data = reinterpret_cast<const std::byte *>(MemoryControlBlock::data(mcb));
+                REQUIRE(std::all_of(data, data + mcb->size(), [](auto b) { return b == std::byte{0}; }));
+            }
+        }
+    }
+
+    // blocks, which are not smaller than fitSize, are found
+    // even if smaller ones do not satisfy predicate
+    auto large = [](const MemoryControlBlock *mcb) noexcept { return mcb->size() >= 7000; };
+    auto *found = list.find(3600, large, 7000);
+    REQUIRE(found != nullptr);
+    REQUIRE(found->size() >= 7000);
+
+    std::size_t count = 0;
+    list.forEach([&count](const MemoryControlBlock *) { ++count; });
+    REQUIRE(count == blocks.size());
+    for (auto *mcb : blocks) {
+        list.pop(mcb);
+    }
+    REQUIRE(list.empty());
+}
+
+TEST_CASE("chunk cache: reuses released range", "[chunk_cache]") {
+    const std::size_t SIZE = hse::system::PAGE_SIZE() * 4;
+    hse::memory::ChunkCache cache;
+
+    REQUIRE(cache.alloc(SIZE) == 0);
+    auto addr = hse::system::mmap(SIZE);
+    cache.free(addr, SIZE);
+    REQUIRE(cache.size() == SIZE);
+
+    // smaller range is cut from the retained one
+    REQUIRE(cache.alloc(SIZE / 2) == addr);
+    REQUIRE(cache.size() == SIZE / 2);
+    REQUIRE(cache.alloc(SIZE) == 0);
+
+    // adjacent ranges are merged back
+    cache.free(addr, SIZE / 2);
+    REQUIRE(cache.alloc(SIZE) == addr);
+    REQUIRE(cache.size() == 0);
+    hse::system::munmap(addr, SIZE);
+
+    // ranges which meet where a reservation can start are not merged
+    const std::size_t REGION_SIZE = hse::memory::PageSource::REGION_SIZE;
+    auto reserved = hse::system::mmap(2 * REGION_SIZE);
+    auto boundary = hse::math::roundUp(reserved + SIZE, REGION_SIZE);
+    cache.free(boundary - SIZE, SIZE);
+    cache.free(boundary, SIZE);
+    REQUIRE(cache.size() == 2 * SIZE);
+    REQUIRE(cache.alloc(2 * SIZE) == 0);
+    REQUIRE(cache.alloc(SIZE) != 0);
+    REQUIRE(cache.alloc(SIZE) != 0);
+    hse::system::munmap(reserved, 2 * REGION_SIZE);
+
+    // ranges of separate mappings are handed out only with their numbers
+    // and merged only with ranges of the same mapping
+    addr = hse::system::mmap(2 * SIZE);
+    cache.free(addr, SIZE, false, 1);
+    cache.free(addr + SIZE, SIZE, false, 2);
+    std::size_t mapping = 0;
+    REQUIRE(cache.alloc(2 * SIZE, nullptr, &mapping) == 0);
+    REQUIRE(cache.alloc(SIZE) == 0);
+    for (std::size_t i = 0; i < 2; ++i) {
+        auto range = cache.alloc(SIZE, nullptr, &mapping);
+        REQUIRE(range == addr + (mapping - 1) * SIZE);
+    }
+    cache.free(addr, SIZE, false, 3);
+    cache.free(addr + SIZE, SIZE, false, 3);
+    REQUIRE(cache.alloc(2 * SIZE, nullptr, &mapping) == addr);
+    REQUIRE(mapping == 3);
+    hse::system::munmap(addr, 2 * SIZE);
+}
+
+TEST_CASE("chunk cache: limit and decay", "[chunk_cache]") {
+    const std::size_t SIZE = hse::system::PAGE_SIZE() * 4;
+    hse::memory::ChunkCache cache;
+
+    cache.setLimit(SIZE);
+    cache.free(hse::system::mmap(SIZE), SIZE);
+    cache.free(hse::system::mmap(SIZE), SIZE);
+    REQUIRE(cache.size() <= SIZE);
+
+    cache.setDecay(hse::memory::ChunkCache::Clock::duration::zero());
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.alloc(SIZE) == 0);
+}
+
+TEST_CASE("page source: commits pages of reserved region in order", "[page_source]") {
+    const std::size_t SIZE = hse::system::PAGE_SIZE() * 4;
+    hse::memory::PageSource pages;
+
+    auto addr = pages.alloc(SIZE);
+    REQUIRE(hse::memory::PageSource::mayStartMapping(addr));
+    REQUIRE(pages.alloc(SIZE) == addr + SIZE);
+    auto *data = reinterpret_cast<std::uint8_t *>(addr);
+    testArray(std::span{data, 2 * SIZE});
+
+    // too large request does not consume region
+    const std::size_t BIG_SIZE = hse::memory::PageSource::REGION_SIZE / 2;
+    auto big = pages.alloc(BIG_SIZE);
+    reinterpret_cast<std::uint8_t *>(big)[BIG_SIZE - 1] = '0';
+    REQUIRE(hse::memory::PageSource::mayStartMapping(big));
+    REQUIRE(pages.alloc(SIZE) == addr + 2 * SIZE);
+    hse::system::munmap(big, BIG_SIZE);
+
+    pages.setHugePages(true);
+    const std::size_t HUGE_PAGE_SIZE = hse::memory::PageSource::HUGE_PAGE_SIZE;
+    big = pages.alloc(BIG_SIZE);
+    REQUIRE(big % HUGE_PAGE_SIZE == 0);
+    hse::system::munmap(big, BIG_SIZE);
+}
+
+TEST_CASE("large allocator: pages moved by realloc are a separate mapping", "[large][realloc][chunk_cache]") {
+    const std::size_t SIZE = hse::memory::LargeAllocator::DEFAULT_THRESHOLD;
+    const std::size_t ALIGNMENT = hse::memory::MemoryControlBlock::ALIGNMENT;
+    hse::memory::ChunkCache chunks;
+    hse::memory::PageSource pages;
+    hse::memory::LargeAllocator large{chunks, pages};
+
+    // the next allocation keeps the first one from growing in place
+    auto ptr = large.alloc(SIZE, ALIGNMENT);
+    auto next = large.alloc(SIZE, ALIGNMENT);
+    REQUIRE(hse::memory::Span::fromPtr(ptr)->mapping() == 0);
+    auto moved = large.realloc(hse::memory::Span::fromPtr(ptr), ptr, SIZE * 4);
+    REQUIRE(moved != 0);
+    REQUIRE(moved != ptr);
+    auto *span = hse::memory::Span::fromPtr(moved);
+    auto mapping = span->mapping();
+    REQUIRE(mapping != 0);
+
+    // retained pages of the mapping are reused only by its owner
+    auto size = span->size();
+    large.free(span, moved);
+    REQUIRE(chunks.alloc(size) == 0);
+    ptr = large.alloc(SIZE * 4, ALIGNMENT);
+    REQUIRE(ptr == moved);
+    REQUIRE(hse::memory::Span::fromPtr(ptr)->mapping() == mapping);
+    large.free(hse::memory::Span::fromPtr(ptr), ptr);
+    large.free(hse::memory::Span::fromPtr(next), next);
+    chunks.purgeAll();
+}
+
+TEST_CASE("slab allocator: slots freed remotely are reused", "[slab][thread]") {
+    const std::size_t THREADS = 4;
+    const std::size_t SLOTS = 256;
+    const std::size_t SIZE_CLASS = hse::memory::sizeClass(64);
+    hse::memory::ChunkCache chunks;
+    hse::memory::PageSource pages;
+    hse::memory::SlabAllocator slabs{chunks, pages};
+
+    std::vector<std::uintptr_t> ptrs;
+    for (std::size_t i = 0; i < SLOTS; ++i) {
+        ptrs.push_back(slabs.alloc(SIZE_CLASS));
+    }
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < THREADS; ++i) {
+        threads.emplace_back([&slabs, &ptrs, i] {
+            for (auto j = i; j < SLOTS; j += THREADS) {
+                slabs.freeRemote(hse::memory::Span::fromPtr(ptrs[j]), ptrs[j]);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // remotely freed slots are returned on the next allocation
+    std::vector<std::uintptr_t> reused;
+    for (std::size_t i = 0; i < SLOTS; ++i) {
+        reused.push_back(slabs.alloc(SIZE_CLASS));
+    }
+    std::sort(ptrs.begin(), ptrs.end());
+    std::sort(reused.begin(), reused.end());
+    REQUIRE(reused == ptrs);
+
+    for (auto ptr : reused) {
+        slabs.free(hse::memory::Span::fromPtr(ptr), ptr);
+    }
+}
+
+TEST_CASE("slab allocator: slots are handed out in random order", "[slab][random]") {
+    const std::size_t SIZE_CLASS = hse::memory::sizeClass(64);
+    const std::size_t SLOTS = (hse::memory::SlabAllocator::SPAN_SIZE
+        - hse::math::roundUp(sizeof(hse::memory::Span), hse::memory::MemoryControlBlock::ALIGNMENT))
+        / hse::memory::classSize(SIZE_CLASS);
+    hse::memory::ChunkCache chunks;
+    hse::memory::PageSource pages;
+    hse::memory::SlabAllocator slabs{chunks, pages};
+
+    auto mode = hse::randomization();
+    hse::setRandomization(hse::Randomization::SLOTS);
+    std::vector<std::uintptr_t> ptrs;
+    for (std::size_t i = 0; i < SLOTS; ++i) {
+        ptrs.push_back(slabs.alloc(SIZE_CLASS));
+    }
+    hse::setRandomization(mode);
+
+    // all slots of a single span are handed out once
+    REQUIRE(!std::is_sorted(ptrs.begin(), ptrs.end()));
+    auto *span = hse::memory::Span::fromPtr(ptrs.front());
+    std::sort(ptrs.begin(), ptrs.end());
+    REQUIRE(std::adjacent_find(ptrs.begin(), ptrs.end()) == ptrs.end());
+    for (auto ptr : ptrs) {
+        REQUIRE(hse::memory::Span::fromPtr(ptr) == span);
+        slabs.free(span, ptr);
+    }
+}
+
+TEST_CASE("arenas: fake topology routes threads to arenas of their nodes", "[arenas][thread]") {
+    const std::array<std::size_t, 3> SIZES{64, 4096, hse::memory::LargeAllocator::DEFAULT_THRESHOLD};
+    const std::size_t ALIGNMENT = hse::memory::MemoryControlBlock::ALIGNMENT;
+    using hse::memory::Stats;
+    static hse::memory::Arenas arenas;
+    arenas.setFakeNodes(2);
+    REQUIRE(arenas.count() == 2);
+
+    // consecutive threads are assigned different nodes
+    std::array<std::size_t, 2> nodes{};
+    std::array<std::array<std::uintptr_t, SIZES.size()>, 2> ptrs{};
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        std::thread([&nodes, &ptrs, &SIZES, i] {
+            nodes[i] = arenas.node();
+            for (std::size_t j = 0; j < SIZES.size(); ++j) {
+                ptrs[i][j] = arenas.local().alloc(SIZES[j], ALIGNMENT);
+            }
+        }).join();
+    }
+    REQUIRE(nodes[0] != nodes[1]);
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        for (auto ptr : ptrs[i]) {
+            REQUIRE(hse::memory::PageMap::arena(ptr) == nodes[i]);
+            REQUIRE(&arenas.owner(ptr) == &arenas[nodes[i]]);
+        }
+    }
+
+    // frees of memory of another node are counted as remote
+    auto local = Stats::get(Stats::numaLocal);
+    auto remote = Stats::get(Stats::numaRemote);
+    std::array<bool, 2> isLocal{};
+    std::thread([&isLocal, &ptrs] {
+        isLocal[0] = arenas.isLocal(ptrs[0][0]);
+        isLocal[1] = arenas.isLocal(ptrs[1][0]);
+        hse::memory::ThreadCache cache{arenas};
+        cache.free(ptrs[0][0]);
+        cache.free(ptrs[1][0]);
+    }).join();
+    REQUIRE(isLocal[0] != isLocal[1]);
+    REQUIRE(Stats::get(Stats::numaLocal) == local + 1);
+    REQUIRE(Stats::get(Stats::numaRemote) == remote + 1);
+
+    for (const auto &nodePtrs : ptrs) {
+        arenas.freeBatch(std::span{nodePtrs}.subspan(1));
+    }
+}
+
+TEST_CASE("malloc_stats_get: counts allocations and reallocations", "[malloc][realloc][free][stats]") {
+    const std::size_t SIZE = hse::memory::LargeAllocator::DEFAULT_THRESHOLD;
+    auto before = hse::malloc_stats_get();
+
+    auto *ptr = hse::malloc(SIZE);
+    auto *block = hse::malloc(MEDIUM_NUMBER);
+    auto stats = hse::malloc_stats_get();
+    REQUIRE(stats.allocated >= before.allocated + SIZE + MEDIUM_NUMBER);
+    REQUIRE(stats.mapped >= stats.allocated);
+    REQUIRE(stats.fragmentation >= 0);
+    REQUIRE(stats.fragmentation < 1);
+
+    ptr = hse::realloc(ptr, SIZE * 4);
+    block = hse::realloc(block, MEDIUM_NUMBER / 2);
+    stats = hse::malloc_stats_get();
+    REQUIRE(stats.reallocsInPlace + stats.reallocsRemapped + stats.reallocsCopied
+        == before.reallocsInPlace + before.reallocsRemapped + before.reallocsCopied + 2);
+    REQUIRE(stats.reallocsInPlace > before.reallocsInPlace);
+
+    hse::free(ptr);
+    hse::free(block);
+    stats = hse::malloc_stats_get();
+    REQUIRE(stats.allocated == before.allocated);
+}
+
+TEST_CASE("malloc_stats_get: sums counters changed by different threads", "[malloc][free][stats][thread]") {
+    auto before = hse::malloc_stats_get();
+
+    void *ptr = nullptr;
+    std::thread([&ptr] { ptr = hse::malloc(MEDIUM_NUMBER); }).join();
+    REQUIRE(hse::malloc_stats_get().allocated >= before.allocated + MEDIUM_NUMBER);
+
+    std::thread([ptr] { hse::free(ptr); }).join();
+    REQUIRE(hse::malloc_stats_get().allocated == before.allocated);
+}